@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstddef>
+
+// Minimal wall-clock harness shared by the bench/ executables
+
+struct BenchStats {
+    double mean_ns;
+    double p50_ns;
+    double p99_ns;
+    double max_ns;
+    double p999_ns;
+};
+
+// Summary of raw per-operation samples; sorts ns in place
+inline BenchStats bench_stats(std::vector<double>& ns) {
+
+    if(ns.empty()) {
+
+        return BenchStats{};
+    }
+
+    double sum = 0;
+
+    for(double v : ns) {
+
+        sum += v;
+    }
+
+    std::sort(ns.begin(), ns.end());
+    const size_t n = ns.size();
+
+    return BenchStats{sum / double(n), ns[n / 2], ns[(n * 99) / 100], ns.back(), ns[(n * 999) / 1000]};
+}
+
+template<class F>
+BenchStats bench_run(size_t iters, F&& f) {
+
+    using clock = std::chrono::steady_clock;
+    std::vector<double> ns(iters);
+
+    for(size_t i = 0; i < iters; ++i) {
+
+        auto t0 = clock::now();
+        f(i);
+        ns[i] = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+    }
+
+    return bench_stats(ns);
+}
+
+inline void bench_print(const char* name, const BenchStats& s) {
+
+    std::printf("%-44s mean %10.0f ns  p50 %10.0f ns  p99 %10.0f ns  max %10.0f ns\n",
+                name, s.mean_ns, s.p50_ns, s.p99_ns, s.max_ns);
+}
@@ -0,0 +1,130 @@
+#include <array>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+
+#include "../bench.h"
+#include "../../test/mocks/spi_mock.h"
+#include "../../include/mram_mr25h40.h"
+#include "../../include/bureau_store.h"
+
+// Virtual MR25H40 (Spi&) vs. BasicMR25H40<Backend> on in-memory backends.
+
+namespace {
+
+    // Lean backend: command and address parsed once, data moved with memcpy
+    class FlatSpi final : public Spi {
+    public:
+        FlatSpi() : mem(MR25H40::kSize) {}
+
+        void transfer(std::span<const uint8_t> tx, std::span<uint8_t> rx) override {
+
+            size_t i = 0;
+
+            while(hdr_n < hdr_len() && i < tx.size()) {
+
+                if(hdr_n == 0) {
+
+                    cmd = tx[i];
+                } else {
+
+                    addr = (addr << 8) | tx[i];
+                }
+
+                ++i;
+                ++hdr_n;
+            }
+
+            if(cmd == MR25H40::WRITE && hdr_n == 4 && i < tx.size() && (sr & MR25H40::SR_WEL)) {
+
+                std::memcpy(mem.data() + addr, tx.data() + i, tx.size() - i);
+                addr += uint32_t(tx.size() - i);
+            }
+
+            if(!rx.empty()) {
+
+                if(cmd == MR25H40::RDSR) {
+
+                    rx[0] = sr;
+                } else if(cmd == MR25H40::READ && hdr_n == 4) {
+
+                    std::memcpy(rx.data(), mem.data() + addr, rx.size());
+                    addr += uint32_t(rx.size());
+                }
+            }
+        }
+
+        void cs_assert() override { hdr_n = 0; addr = 0; }
+
+        void cs_deassert() override {
+
+            if(cmd == MR25H40::WREN) sr |= MR25H40::SR_WEL;
+            if(cmd == MR25H40::WRDI) sr &= uint8_t(~MR25H40::SR_WEL);
+        }
+
+        void delay_us(uint32_t) override {}
+
+        std::vector<uint8_t> mem;
+
+    private:
+        uint8_t cmd = 0, sr = 0;
+        uint32_t addr = 0;
+        size_t hdr_n = 0;
+
+        size_t hdr_len() const { return hdr_n > 0 && (cmd == MR25H40::READ || cmd == MR25H40::WRITE) ? 4 : 1; }
+    };
+
+    template<class Driver, class Store>
+    void run(const char* backend, Driver& mram, Store& store) {
+
+        constexpr size_t kIters = 200000;
+        std::array<uint8_t, 16> buf{};
+        char name[96];
+
+        std::snprintf(name, sizeof(name), "%s read 16 B", backend);
+        bench_print(name, bench_run(kIters, [&](size_t i) { mram.read(uint32_t(i % 4096) * 16, buf); }));
+
+        std::snprintf(name, sizeof(name), "%s write 16 B", backend);
+        bench_print(name, bench_run(kIters, [&](size_t i) { mram.write(uint32_t(i % 4096) * 16, buf); }));
+
+        std::snprintf(name, sizeof(name), "%s store write+read", backend);
+        bench_print(name, bench_run(kIters / 4, [&](size_t i) {
+            store.write(Bureau{.prog_qty = i, .math_qty = 1, .head_qty = 2, .salary_sum = 3.0f});
+            (void)store.read();
+        }));
+    }
+
+}
+
+int main() {
+
+    {
+        FlatSpi spi;
+        MR25H40 mram(spi);
+        BureauStore store(mram);
+        run("FlatSpi  virtual    ", mram, store);
+    }
+
+    {
+        FlatSpi spi;
+        BasicMR25H40<FlatSpi> mram(spi);
+        BasicBureauStore<FlatSpi> store(mram);
+        run("FlatSpi  templated  ", mram, store);
+    }
+
+    {
+        SpiMock spi;
+        MR25H40 mram(spi);
+        BureauStore store(mram);
+        run("SpiMock  virtual    ", mram, store);
+    }
+
+    {
+        SpiMock spi;
+        BasicMR25H40<SpiMock> mram(spi);
+        BasicBureauStore<SpiMock> store(mram);
+        run("SpiMock  templated  ", mram, store);
+    }
+
+    return 0;
+}
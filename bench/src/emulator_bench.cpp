@@ -0,0 +1,42 @@
+#include <vector>
+#include <cstdio>
+
+#include "../bench.h"
+#include "../../test/mocks/spi_mock.h"
+#include "../../include/mram_emulator.h"
+#include "../../include/mram_mr25h40.h"
+
+// Backend cost of large transfers: SpiMock buffers every byte in inbuf and
+// applies WRITE at CS high, the emulator copies straight to the array.
+
+namespace {
+
+    template<class Backend>
+    void run(const char* name) {
+
+        Backend spi;
+        MR25H40 mram(spi);
+        std::vector<uint8_t> buf(64 * 1024, 0x3C);
+        char label[64];
+
+        std::snprintf(label, sizeof(label), "%s write 64 KiB", name);
+        const BenchStats w = bench_run(200, [&](size_t i) { mram.write(uint32_t(i % 8) * 0x10000, buf); });
+        bench_print(label, w);
+
+        std::snprintf(label, sizeof(label), "%s read 64 KiB", name);
+        const BenchStats r = bench_run(200, [&](size_t i) { mram.read(uint32_t(i % 8) * 0x10000, buf); });
+        bench_print(label, r);
+
+        std::printf("%-44s write %8.1f MiB/s  read %8.1f MiB/s\n", "",
+                    65536.0 / w.mean_ns * 1e9 / (1 << 20), 65536.0 / r.mean_ns * 1e9 / (1 << 20));
+    }
+
+}
+
+int main() {
+
+    run<SpiMock>("SpiMock        ");
+    run<MR25H40Emulator>("MR25H40Emulator");
+
+    return 0;
+}
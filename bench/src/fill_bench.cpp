@@ -0,0 +1,36 @@
+#include <vector>
+#include <cstdio>
+
+#include "../bench.h"
+#include "../../include/mram_emulator.h"
+#include "../../include/mram_mr25h40.h"
+
+// erase_all() streamed from a 256-byte pattern vs. building a 512 KiB
+// buffer and handing it to write().
+
+int main() {
+
+    MR25H40Emulator spi;
+    MR25H40 mram(spi);
+    constexpr size_t kIters = 20;
+
+    bench_print("naive: vector(512 KiB) + write", bench_run(kIters, [&](size_t i) {
+        std::vector<uint8_t> buf(MR25H40::kSize, uint8_t(i));
+        mram.write(0, buf);
+    }));
+
+    bench_print("erase_all (streamed pattern)", bench_run(kIters, [&](size_t i) {
+        mram.erase_all(uint8_t(i));
+    }));
+
+    bench_print("naive: vector(4 KiB) + write", bench_run(kIters * 100, [&](size_t i) {
+        std::vector<uint8_t> buf(4096, uint8_t(i));
+        mram.write(0x1000, buf);
+    }));
+
+    bench_print("fill 4 KiB", bench_run(kIters * 100, [&](size_t i) {
+        mram.fill(0x1000, 4096, uint8_t(i));
+    }));
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../bench.h"
+#include "../../test/mocks/spi_mock.h"
+#include "../../include/mram_mr25h40.h"
+#include "../../include/bureau_store.h"
+
+// Built twice: against the hosted core and against the freestanding
+// (-fno-exceptions -fno-rtti) core, to compare per-call latency.
+
+int main() {
+
+    std::printf("profile: %s\n", MRAM_FREESTANDING ? "freestanding" : "hosted");
+
+    SpiMock spi;
+    MR25H40 mram(spi);
+    BureauStore store(mram);
+    constexpr size_t kIters = 20000;
+
+    static std::array<uint8_t, 4096> buf{};
+
+    bench_print("MR25H40::try_write 64 B", bench_run(kIters, [&](size_t i) {
+        if(!mram.try_write(uint32_t(i % 1024) * 64, std::span<const uint8_t>(buf.data(), 64))) std::abort();
+    }));
+
+    bench_print("MR25H40::try_read 64 B", bench_run(kIters, [&](size_t i) {
+        if(!mram.try_read(uint32_t(i % 1024) * 64, std::span<uint8_t>(buf.data(), 64))) std::abort();
+    }));
+
+    bench_print("MR25H40::try_read 4 KiB", bench_run(kIters / 10, [&](size_t i) {
+        if(!mram.try_read(uint32_t(i % 64) * 4096, buf)) std::abort();
+    }));
+
+    bench_print("BureauStore::try_write", bench_run(kIters, [&](size_t i) {
+        Bureau b{.prog_qty = i, .math_qty = uint32_t(i), .head_qty = 1, .salary_sum = 1.0f};
+        if(!store.try_write(b)) std::abort();
+    }));
+
+    bench_print("BureauStore::try_read", bench_run(kIters, [&](size_t) {
+        if(!store.try_read()) std::abort();
+    }));
+
+#if !MRAM_FREESTANDING
+    bench_print("MR25H40::read 64 B (throwing API)", bench_run(kIters, [&](size_t i) {
+        mram.read(uint32_t(i % 1024) * 64, std::span<uint8_t>(buf.data(), 64));
+    }));
+
+    bench_print("BureauStore::read (throwing API)", bench_run(kIters, [&](size_t) {
+        (void)store.read();
+    }));
+#endif
+
+    return 0;
+}
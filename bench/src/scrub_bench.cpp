@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "../bench.h"
+#include "../../include/mram_emulator.h"
+#include "../../include/bus_gate.h"
+#include "../../include/scrubber.h"
+#include "../../include/bureau_store.h"
+#include "../../include/bureau_history.h"
+
+// Foreground BureauStore::read latency while the scrubber runs on the same bus.
+
+namespace {
+
+    constexpr uint32_t kHistBase = 0x4000;
+    constexpr uint32_t kHistSize = 256 * BureauHistory::kBlockSize;
+
+    void run(const char* name, const ScrubConfig* cfg) {
+
+        MR25H40Emulator spi;
+        BusGate gate;
+        GatedSpi fg(spi, gate, BusPriority::Foreground);
+        MR25H40 mram(fg);
+        BureauStore store(mram);
+        BureauHistory hist(mram, kHistBase, kHistSize);
+
+        for(uint32_t i = 0; i < 5000; ++i) {
+
+            Bureau b{.prog_qty = i, .math_qty = i, .head_qty = 1, .salary_sum = float(i)};
+            store.write(b);
+            hist.append(b);
+        }
+
+        std::unique_ptr<Scrubber> scrub;
+
+        if(cfg) {
+
+            scrub = std::make_unique<Scrubber>(spi, gate,
+                std::vector<ScrubTarget>{ScrubTargets::store_records(), ScrubTargets::history(kHistBase, kHistSize)},
+                *cfg);
+            scrub->start();
+        }
+
+        bench_print(name, bench_run(50000, [&](size_t) { (void)store.read(); }));
+
+        if(scrub) {
+
+            scrub->stop();
+            std::printf("%-44s scrubbed %llu bytes, %llu passes\n", "", (unsigned long long)scrub->bytes_read(),
+                        (unsigned long long)scrub->passes());
+        }
+    }
+
+}
+
+int main() {
+
+    run("foreground only", nullptr);
+
+    ScrubConfig budget{.bytes_per_sec = 1024 * 1024, .chunk = 256, .pass_interval = std::chrono::milliseconds(0)};
+    run("scrubber 1 MiB/s, background priority", &budget);
+
+    ScrubConfig flat_out{.bytes_per_sec = 0, .chunk = 256, .pass_interval = std::chrono::milliseconds(0)};
+    run("scrubber unthrottled, background priority", &flat_out);
+
+    ScrubConfig same_prio = flat_out;
+    same_prio.priority = BusPriority::Foreground;
+    run("scrubber unthrottled, equal priority", &same_prio);
+
+    return 0;
+}
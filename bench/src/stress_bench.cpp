@@ -0,0 +1,278 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../bench.h"
+#include "../../include/mram_emulator.h"
+#include "../../include/bus_gate.h"
+#include "../../include/bureau_store.h"
+
+// Readers and writers on BureauStore and raw MR25H40 blocks, every thread
+// with its own driver over one shared backend behind BusGate. Reports
+// throughput and latency per thread count and checks that no reader ever
+// sees a torn Bureau or block.
+//
+// BureauStore::write reads the slots, then writes one, so writers of the
+// shared store hold a store lock around it. The store check is about that
+// lock: readers must never see the seqno go backwards, and at the end the
+// seqno and the summary count must equal the number of writes.
+//
+//   mram_stress [--threads 1,2,4,8] [--ms 1000] [--read-pct 75] [--target store|raw|both]
+//               [--max-transfer N] [--store-lock on|off]
+//
+// --max-transfer splits transfers (MR25H40::set_max_transfer), so raw blocks
+// are no longer read or written atomically: torn counts there show the check
+// works. --store-lock off drops the store lock, so lost updates show up.
+
+namespace {
+
+    constexpr uint32_t kRawBase = 0x10000;
+    constexpr uint32_t kRawBlocks = 64;
+    constexpr uint32_t kRawBlock = 256;
+
+    struct Config {
+        std::vector<unsigned> threads{1, 2, 4, 8};
+        unsigned ms = 1000;
+        unsigned read_pct = 75;
+        bool store = true;
+        bool raw = true;
+        size_t max_transfer = 0;
+        bool store_lock = true;
+    };
+
+    // Every field derives from prog_qty, so a mix of two records shows up
+    Bureau stamped(uint64_t v) {
+
+        return Bureau{.prog_qty = size_t(v), .math_qty = uint32_t(v * 2654435761u),
+                      .head_qty = uint8_t(v ^ (v >> 8)), .salary_sum = float(v & 0xFFFF)};
+    }
+
+    bool intact(const Bureau& b) {
+
+        const Bureau e = stamped(b.prog_qty);
+
+        return b.math_qty == e.math_qty && b.head_qty == e.head_qty && b.salary_sum == e.salary_sum;
+    }
+
+    // Block filled with one repeated 32-bit stamp
+    bool intact(std::span<const uint8_t> blk) {
+
+        return std::memcmp(blk.data(), blk.data() + 4, blk.size() - 4) == 0;
+    }
+
+    uint64_t xorshift(uint64_t& s) {
+
+        s ^= s << 13;
+        s ^= s >> 7;
+        s ^= s << 17;
+        return s;
+    }
+
+    struct Totals {
+        uint64_t ops = 0;
+        uint64_t torn = 0;
+        uint64_t lost = 0;         // store seqno going back or writes missing
+        uint64_t errors = 0;
+        std::vector<double> ns;
+    };
+
+    Totals run(const Config& cfg, unsigned nthreads) {
+
+        MR25H40Emulator spi;
+        BusGate gate;
+
+        {
+            GatedSpi bus(spi, gate, BusPriority::Foreground);
+            MR25H40 mram(bus);
+            BureauStore(mram).write(stamped(0));
+        }
+
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> next_stamp{1};
+        std::atomic<uint64_t> store_writes{1};   // stamped(0) above
+        std::mutex store_mu;
+        std::vector<Totals> per(nthreads);
+        std::vector<std::thread> ts;
+
+        for(unsigned t = 0; t < nthreads; ++t) {
+
+            ts.emplace_back([&, t] {
+
+                using clock = std::chrono::steady_clock;
+                GatedSpi bus(spi, gate, BusPriority::Foreground);
+                MR25H40 mram(bus);
+                mram.set_max_transfer(cfg.max_transfer);
+                BureauStore store(mram);
+                std::array<uint8_t, kRawBlock> blk{};
+                uint64_t rng = 0x9E3779B97F4A7C15ull * (t + 1);
+                uint64_t seen = 0;
+                Totals& out = per[t];
+                out.ns.reserve(1 << 20);
+
+                while(!stop.load(std::memory_order_relaxed)) {
+
+                    const uint64_t r = xorshift(rng);
+                    const bool read = r % 100 < cfg.read_pct;
+                    const bool on_store = cfg.store && (!cfg.raw || (r >> 8) & 1);
+                    const auto t0 = clock::now();
+
+                    try {
+
+                        if(on_store && read) {
+
+                            const uint64_t seqno = store.read_summary().seqno;
+                            out.lost += seqno < seen;
+                            seen = std::max(seen, seqno);
+                            out.torn += !intact(store.read());
+                        } else if(on_store) {
+
+                            std::unique_lock<std::mutex> lock(store_mu, std::defer_lock);
+
+                            if(cfg.store_lock) {
+
+                                lock.lock();
+                            }
+
+                            store.write(stamped(next_stamp++));
+                            store_writes++;
+                        } else {
+
+                            const uint32_t addr = kRawBase + uint32_t((r >> 16) % kRawBlocks) * kRawBlock;
+
+                            if(read) {
+
+                                mram.read(addr, blk);
+                                out.torn += !intact(blk);
+                            } else {
+
+                                const auto v = uint32_t(next_stamp++);
+
+                                for(size_t i = 0; i < blk.size(); i += 4) {
+
+                                    std::memcpy(blk.data() + i, &v, 4);
+                                }
+
+                                mram.write(addr, blk);
+                            }
+                        }
+                    } catch(const std::exception&) {
+
+                        out.errors++;
+                    }
+
+                    out.ns.push_back(std::chrono::duration<double, std::nano>(clock::now() - t0).count());
+                    out.ops++;
+                }
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(cfg.ms));
+        stop = true;
+
+        Totals all;
+
+        for(unsigned t = 0; t < nthreads; ++t) {
+
+            ts[t].join();
+            all.ops += per[t].ops;
+            all.torn += per[t].torn;
+            all.lost += per[t].lost;
+            all.errors += per[t].errors;
+            all.ns.insert(all.ns.end(), per[t].ns.begin(), per[t].ns.end());
+        }
+
+        // Every successful write is one seqno and one summary entry
+        GatedSpi bus(spi, gate, BusPriority::Foreground);
+        MR25H40 mram(bus);
+        const StoreSummary s = BureauStore(mram).read_summary();
+        const uint64_t writes = store_writes.load();
+
+        all.lost += s.seqno > writes ? s.seqno - writes : writes - s.seqno;
+        all.lost += s.count != s.seqno;
+
+        return all;
+    }
+
+    bool parse(int argc, char* argv[], Config& cfg) {
+
+        for(int i = 1; i < argc; ++i) {
+
+            const std::string arg = argv[i];
+
+            if(i + 1 >= argc) {
+
+                return false;
+            }
+
+            const std::string val = argv[++i];
+
+            if(arg == "--threads") {
+
+                cfg.threads.clear();
+
+                for(size_t pos = 0; pos < val.size();) {
+
+                    size_t end = val.find(',', pos);
+                    end = end == std::string::npos ? val.size() : end;
+                    cfg.threads.push_back(unsigned(std::stoul(val.substr(pos, end - pos))));
+                    pos = end + 1;
+                }
+            } else if(arg == "--ms") {
+
+                cfg.ms = unsigned(std::stoul(val));
+            } else if(arg == "--read-pct") {
+
+                cfg.read_pct = unsigned(std::stoul(val));
+            } else if(arg == "--max-transfer") {
+
+                cfg.max_transfer = std::stoul(val);
+            } else if(arg == "--store-lock") {
+
+                cfg.store_lock = val != "off";
+            } else if(arg == "--target") {
+
+                cfg.store = val != "raw";
+                cfg.raw = val != "store";
+            } else {
+
+                return false;
+            }
+        }
+
+        return !cfg.threads.empty() && cfg.read_pct <= 100;
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+
+    Config cfg;
+
+    if(!parse(argc, argv, cfg)) {
+
+        std::fprintf(stderr, "usage: %s [--threads 1,2,4,8] [--ms 1000] [--read-pct 75] [--target store|raw|both] [--max-transfer N] [--store-lock on|off]\n", argv[0]);
+        return 2;
+    }
+
+    uint64_t bad = 0;
+
+    for(unsigned n : cfg.threads) {
+
+        Totals t = run(cfg, n);
+        const BenchStats s = bench_stats(t.ns);
+
+        std::printf("threads %2u  %10.0f ops/s  p50 %8.0f ns  p99 %8.0f ns  p999 %8.0f ns  torn %llu  lost %llu  errors %llu\n",
+                    n, double(t.ops) * 1000.0 / cfg.ms, s.p50_ns, s.p99_ns, s.p999_ns,
+                    (unsigned long long)t.torn, (unsigned long long)t.lost, (unsigned long long)t.errors);
+        bad += t.torn + t.lost + t.errors;
+    }
+
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,57 @@
+# Benchmarks (build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers)
+
+add_executable(mram_bench_profile_hosted
+	bench/src/profile_bench.cpp)
+target_link_libraries(mram_bench_profile_hosted
+PRIVATE
+	mram_core_hosted
+)
+
+add_executable(mram_bench_profile_freestanding
+	bench/src/profile_bench.cpp)
+target_link_libraries(mram_bench_profile_freestanding
+PRIVATE
+	mram_core_freestanding
+)
+
+add_executable(mram_bench_fill
+	bench/src/fill_bench.cpp)
+target_link_libraries(mram_bench_fill
+PRIVATE
+	mram_core_hosted
+	mram_emulator
+)
+
+add_executable(mram_bench_devirt
+	bench/src/devirt_bench.cpp)
+target_link_libraries(mram_bench_devirt
+PRIVATE
+	mram_core_hosted
+)
+
+add_executable(mram_bench_emulator
+	bench/src/emulator_bench.cpp)
+target_link_libraries(mram_bench_emulator
+PRIVATE
+	mram_core_hosted
+	mram_emulator
+)
+
+add_executable(mram_bench_scrub
+	bench/src/scrub_bench.cpp
+	${sources})
+target_link_libraries(mram_bench_scrub
+PRIVATE
+	pthread
+)
+
+add_executable(mram_stress
+	bench/src/stress_bench.cpp
+	${sources})
+target_link_libraries(mram_stress
+PRIVATE
+	pthread
+)
+
+# Short run as a consistency check: fails on any torn read
+add_test(NAME mram_stress_smoke COMMAND mram_stress --threads 1,4 --ms 200)
@@ -0,0 +1,4 @@
+# In-process MR25H40 emulator, reusable by tests, benchmarks and tools
+
+add_library(mram_emulator STATIC
+	src/mram_emulator.cpp)
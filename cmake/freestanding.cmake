@@ -0,0 +1,45 @@
+# Freestanding profile: driver, codec and store without exceptions, RTTI or heap.
+# The same sources are also built hosted so the two can be compared.
+
+set(core_sources
+	src/bureau_codec.cpp
+	src/bureau_store.cpp
+	src/mram_mr25h40.cpp
+)
+
+add_library(mram_core_hosted STATIC
+	${core_sources})
+
+add_library(mram_core_freestanding STATIC
+	${core_sources})
+
+target_compile_definitions(mram_core_freestanding
+PUBLIC
+	MRAM_FREESTANDING=1
+)
+target_compile_options(mram_core_freestanding
+PUBLIC
+	-fno-exceptions
+	-fno-rtti
+)
+
+add_executable(mram_driver_freestanding_test
+	test/src/main_test.cpp
+	test/src/result_api_test.cpp)
+
+target_link_libraries(mram_driver_freestanding_test
+PRIVATE
+	mram_core_freestanding
+	gtest
+	gmock
+	pthread
+)
+
+add_test(NAME mram_driver_freestanding_test COMMAND mram_driver_freestanding_test)
+
+# Code size of both profiles: cmake --build <dir> --target size_report
+add_custom_target(size_report
+	COMMAND size -t $<TARGET_FILE:mram_core_hosted>
+	COMMAND size -t $<TARGET_FILE:mram_core_freestanding>
+	DEPENDS mram_core_hosted mram_core_freestanding
+)
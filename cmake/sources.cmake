@@ -1,7 +1,15 @@
 set(sources
 	src/bureau_codec.cpp
+	src/bureau_history.cpp
+	src/bureau_queue.cpp
 	src/bureau_store.cpp
+	src/bureau_tx.cpp
+	src/bus_gate.cpp
+	src/mram_emulator.cpp
+	src/mram_heap.cpp
+	src/mram_image.cpp
 	src/mram_mr25h40.cpp
+	src/scrubber.cpp
 )
 
 set(exe_sources
@@ -16,8 +24,18 @@ set(headers
 set(test_src
 	test/src/main_test.cpp
 	test/src/bureau_codec_test.cpp
+	test/src/bureau_history_test.cpp
+	test/src/bureau_queue_test.cpp
 	test/src/bureau_store_test.cpp
+	test/src/bureau_tx_test.cpp
+	test/src/bus_gate_test.cpp
 	test/src/e2e_test.cpp
+	test/src/emulator_test.cpp
+	test/src/mram_heap_test.cpp
+	test/src/mram_image_test.cpp
 	test/src/mram_test.cpp
+	test/src/record_store_test.cpp
+	test/src/result_api_test.cpp
+	test/src/scrubber_test.cpp
 	${sources}
 )
@@ -7,3 +7,5 @@ PRIVATE
 	gmock
 	pthread
 )
+
+add_test(NAME mram_driver_test COMMAND mram_driver_test)
@@ -5,7 +5,8 @@
 #include <span>
 #include <cstring>
 #include <limits>
-#include <stdexcept>
+
+#include "mram_result.h"
 
 struct Bureau {
     size_t   prog_qty;
@@ -20,6 +21,10 @@ namespace BureauCodec {
     constexpr uint16_t kVersion = 1;
 
     void encode(const Bureau& b, std::span<uint8_t, kSize> out);
+    Result<Bureau> try_decode(std::span<const uint8_t, kSize> in);
+
+#if !MRAM_FREESTANDING
     Bureau decode(std::span<const uint8_t, kSize> in);
+#endif
 
 }//ns_bureau_codec
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <span>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <limits>
+#include <algorithm>
+
+#include "mram_mr25h40.h"
+#include "bureau_codec.h"
+
+// Compact history of Bureau snapshots.
+//
+// The region is split into fixed blocks used as a ring. Every block starts
+// with a HistoryBlockHeader; its body holds one keyframe (the full
+// BureauCodec encoding) followed by records stored as zig-zag varint deltas
+// against the previous snapshot. Header and keyframe are written once, when
+// the block is opened; each delta is followed by a check byte (never 0, from
+// a CRC of seqno and delta) and committed by its own WRITE into a body that
+// was zeroed beforehand. A delta cut short lacks its check byte, so mount
+// keeps every record up to the last complete one.
+struct HistoryBlockHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;        // 1: the keyframe (deltas are counted by walking the body)
+    uint32_t used;         // keyframe bytes
+    uint32_t crc32;        // CRC32 of the keyframe
+    uint64_t first_seqno;  // seqno of the keyframe
+};
+
+static_assert(sizeof(HistoryBlockHeader)==24);
+
+namespace HistoryCodec {
+
+    constexpr size_t kMaxDelta = 10 + 5 + 5 + 5; // worst case varints per record
+
+    // Delta of cur against prev, returns bytes written to out
+    size_t encode_delta(const Bureau& prev, const Bureau& cur, std::span<uint8_t, kMaxDelta> out);
+    // Applies one delta at in[pos] to b, advances pos
+    void decode_delta(std::span<const uint8_t> in, size_t& pos, Bureau& b);
+
+}//ns_history_codec
+
+class BureauHistory {
+
+public:
+    static constexpr uint32_t kBlockSize = 256;
+    static constexpr uint32_t kBodySize = kBlockSize - sizeof(HistoryBlockHeader);
+    static constexpr uint32_t kDefaultBase = 0x01000;
+    static constexpr uint32_t kDefaultSize = 0x40000 - kDefaultBase;
+
+    explicit BureauHistory(MR25H40& mram, uint32_t base = kDefaultBase, uint32_t size = kDefaultSize);
+
+    uint64_t append(const Bureau& b);
+    Bureau at(uint64_t seqno);
+
+    // Streams snapshots with seqno in [from, to] (clamped to what is held) in
+    // order. Blocks are fetched batch_blocks at a time with one READ and
+    // decoded in place, so only O(batch) bytes are held in RAM.
+    using ScanCallback = std::function<void(uint64_t seqno, const Bureau& b)>;
+    void scan(uint64_t from, uint64_t to, const ScanCallback& fn, uint32_t batch_blocks = 8);
+
+    bool empty() const { return live_ == 0; }
+    uint64_t first_seqno() const;
+    uint64_t last_seqno() const;
+    uint64_t size() const { return empty() ? 0 : last_seqno() - first_seqno() + 1; }
+    uint32_t blocks() const { return nblocks_; }
+    uint32_t live_blocks() const { return live_; }
+
+    // Raw check of one kBlockSize block, for tools that walk the device
+    static SlotState check_block(std::span<const uint8_t> raw);
+
+private:
+    MR25H40& mram_;
+    uint32_t base_;
+    uint32_t nblocks_;
+    static constexpr uint32_t MAGIC = 0x54534842; //=BHST
+    static constexpr uint16_t VERSION = 2;
+
+    // Per physical block: seqno of its keyframe, 0 if empty/invalid
+    std::vector<uint64_t> first_seq_;
+    uint32_t tail_ = 0;   // oldest live block
+    uint32_t live_ = 0;   // live blocks, head = (tail_ + live_ - 1) % nblocks_
+
+    // Open (head) block mirrored in RAM; its count and used take in the deltas
+    HistoryBlockHeader open_hdr_{};
+    std::array<uint8_t,kBodySize> open_body_{};
+    Bureau last_{};
+
+    uint32_t block_addr(uint32_t idx) const { return base_ + idx * kBlockSize; }
+    uint32_t head() const { return (tail_ + live_ - 1) % nblocks_; }
+    void mount();
+    bool load_block(uint32_t idx, HistoryBlockHeader& h, std::span<uint8_t, kBodySize> body);
+    // Header and keyframe only / also every byte after the last delta is zero
+    static bool valid_keyframe(const HistoryBlockHeader& h, std::span<const uint8_t> body);
+    static bool valid_block(const HistoryBlockHeader& h, std::span<const uint8_t> body);
+    void start_block(uint64_t seqno, const Bureau& b);
+    std::optional<uint32_t> find_block(uint64_t seqno) const;
+
+};//class_bureau_history
+
+// Streaming queries over a seqno range of BureauHistory
+namespace HistoryQuery {
+
+    // Exact sum of 64-bit terms as two words with carry: no compiler
+    // extension, the same on hosted and MCU targets. Up to 2^64 terms
+    struct Sum128 {
+        uint64_t hi = 0;
+        uint64_t lo = 0;
+
+        void add(uint64_t v) {
+
+            lo += v;
+            hi += lo < v;
+        }
+
+        bool operator==(const Sum128&) const = default;
+    };
+
+    // Integer fields: exact 128-bit sum, 64-bit min/max
+    struct IntStats {
+        uint64_t count = 0;
+        Sum128 sum{};
+        uint64_t min = std::numeric_limits<uint64_t>::max();
+        uint64_t max = 0;
+
+        void add(uint64_t v) {
+
+            count++;
+            sum.add(v);
+            min = v < min ? v : min;
+            max = v > max ? v : max;
+        }
+    };
+
+    // salary_sum is a float: summed in double, min/max kept exactly
+    struct RealStats {
+        uint64_t count = 0;
+        double sum = 0;
+        float min = std::numeric_limits<float>::infinity();
+        float max = -std::numeric_limits<float>::infinity();
+
+        void add(float v) {
+
+            count++;
+            sum += double(v);
+            min = v < min ? v : min;
+            max = v > max ? v : max;
+        }
+    };
+
+    // Integer fields of Bureau
+    enum class Field { ProgQty, MathQty, HeadQty };
+    constexpr size_t kFields = 3;
+
+    inline uint64_t value(const Bureau& b, Field f) {
+
+        switch(f) {
+            case Field::ProgQty:   return uint64_t(b.prog_qty);
+            case Field::MathQty:   return b.math_qty;
+            case Field::HeadQty:   return b.head_qty;
+        }
+
+        return 0;
+    }
+
+    // count/sum/min/max of every field in one pass
+    struct Aggregate {
+        uint64_t first_seqno = 0;
+        uint64_t last_seqno = 0;
+        std::array<IntStats,kFields> fields{};
+        RealStats salary{};
+
+        const IntStats& operator[](Field f) const { return fields[size_t(f)]; }
+        uint64_t count() const { return salary.count; }
+    };
+
+    // [from, to] covering the last n snapshots held
+    inline std::pair<uint64_t,uint64_t> last_n(const BureauHistory& h, uint64_t n) {
+
+        if(h.empty() || n == 0) {
+
+            return {1,0};
+        }
+
+        const uint64_t from = n >= h.size() ? h.first_seqno() : h.last_seqno() - n + 1;
+
+        return {from,h.last_seqno()};
+    }
+
+    Aggregate aggregate(BureauHistory& h, uint64_t from, uint64_t to);
+    // count/sum/min/max of one field in one pass
+    IntStats stats(BureauHistory& h, uint64_t from, uint64_t to, Field f);
+    RealStats salary_stats(BureauHistory& h, uint64_t from, uint64_t to);
+
+    // Snapshots held in [from, to]: seqnos are contiguous, so no scan
+    inline uint64_t count(const BureauHistory& h, uint64_t from, uint64_t to) {
+
+        if(h.empty()) {
+
+            return 0;
+        }
+
+        from = std::max(from,h.first_seqno());
+        to = std::min(to,h.last_seqno());
+
+        return from > to ? 0 : to - from + 1;
+    }
+
+    // Custom reducer: acc = r(acc, seqno, bureau) over the range
+    template<class Acc, class Reduce>
+    Acc reduce(BureauHistory& h, uint64_t from, uint64_t to, Acc init, Reduce r) {
+
+        h.scan(from,to,[&](uint64_t seqno, const Bureau& b) { init = r(std::move(init),seqno,b); });
+
+        return init;
+    }
+
+}//ns_history_query
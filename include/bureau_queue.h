@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "mram_mr25h40.h"
+#include "bureau_codec.h"
+
+// Head or tail position of a BureauQueue, one A/B pair per side. The CRC
+// covers every field but itself.
+struct QueueCheckpoint {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t side;         // 0 head (consumer), 1 tail (producer)
+    uint32_t capacity;
+    uint32_t crc32;
+    uint64_t seqno;        // checkpoint generation
+    uint64_t pos;          // absolute item position
+};
+
+static_assert(sizeof(QueueCheckpoint)==32);
+
+// Ring entry: the absolute position tells a fresh entry from the one it
+// replaced a lap earlier; the CRC covers pos and payload.
+struct QueueEntry {
+    uint64_t pos;
+    uint8_t  payload[BureauCodec::kSize];
+    uint32_t crc32;
+};
+
+static_assert(sizeof(QueueEntry)==32);
+
+// Persistent single-producer single-consumer queue of Bureau records:
+//
+//   producer: q.push(b) ... q.flush();     consumer: while(auto b = q.pop()) ...
+//
+// push() and pop() work on a RAM mirror of the ring with atomic head and
+// tail, so the two threads never wait for the bus. The producer writes its
+// entries once per `batch` pushes (or at flush()) with one WRITE, two when
+// the batch wraps the ring, and a tail checkpoint every kTailEvery batches.
+// The consumer writes a head checkpoint every `batch` pops, or when it calls
+// commit(); with set_idle_commit(true) also at the first empty pop(), which
+// under a trickle of single items costs one WRITE per item. A slot is reused
+// only once the head checkpoint has moved past it, so everything between the
+// durable head and tail is still on the device.
+//
+// Mount resumes at the newest valid head checkpoint, takes the entries up to
+// the tail checkpoint and then scans forward while entries carry the next
+// position and a good CRC. An entry below the tail checkpoint that fails the
+// check was written and then damaged: it is counted in lost() and pop() skips
+// it, the entries after it are still delivered. Popped items whose head
+// checkpoint was not written yet are delivered again; pushed items not yet
+// flushed are lost.
+//
+// Each side may use its own driver (e.g. GatedSpi over one BusGate). Built
+// over a single driver, the queue serialises the two sides' device accesses
+// itself, since the driver is not safe to call from two threads.
+class BureauQueue {
+
+public:
+    static constexpr uint32_t kTailEvery = 8;
+    static constexpr uint32_t kMetaSize = 4 * sizeof(QueueCheckpoint);
+
+    static constexpr uint32_t footprint(uint32_t capacity) { return kMetaSize + capacity * uint32_t(sizeof(QueueEntry)); }
+
+    BureauQueue(MR25H40& mram, uint32_t base, uint32_t capacity, uint32_t batch = 16);
+    BureauQueue(MR25H40& producer, MR25H40& consumer, uint32_t base, uint32_t capacity, uint32_t batch = 16);
+
+    BureauQueue(const BureauQueue&) = delete;
+    BureauQueue& operator=(const BureauQueue&) = delete;
+
+    // Producer side. push() returns false while the ring is full
+    bool push(const Bureau& b);
+    void flush();
+    // flush() and a tail checkpoint
+    void checkpoint();
+
+    // Consumer side
+    std::optional<Bureau> pop();
+    void commit();
+    // Head checkpoint at the first empty pop() after items were taken: fewer
+    // items delivered again after a restart, one WRITE per idle period
+    void set_idle_commit(bool on) { idle_commit_ = on; }
+
+    uint32_t capacity() const { return capacity_; }
+    uint32_t batch() const { return batch_; }
+    uint64_t head() const { return head_.load(std::memory_order_acquire); }
+    uint64_t tail() const { return tail_.load(std::memory_order_acquire); }
+    size_t size() const { return size_t(tail() - head()); }
+    uint64_t durable_head() const { return durable_head_.load(std::memory_order_acquire); }
+    uint64_t flushed() const { return flushed_; }
+
+    // Found at mount past the tail checkpoint / skipped before it (bad CRC)
+    uint64_t scanned() const { return scanned_; }
+    uint64_t lost() const { return lost_; }
+
+private:
+    MR25H40& prod_;
+    MR25H40& cons_;
+    // Held around device access when both sides share one driver
+    std::mutex shared_bus_;
+    uint32_t base_;
+    uint32_t capacity_;
+    uint32_t batch_;
+    static constexpr uint32_t MAGIC = 0x55455551; //=QUEU
+    static constexpr uint16_t VERSION = 1;
+
+    // RAM mirror: decoded items for pop() and encoded entries for flush().
+    // Slots mount found damaged below the tail checkpoint are marked in
+    // holes_, which only the consumer clears as it passes them
+    std::vector<Bureau> items_;
+    std::vector<uint8_t> image_;
+    std::vector<uint8_t> holes_;
+
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> tail_{0};
+    std::atomic<uint64_t> durable_head_{0};
+
+    // Producer only
+    uint64_t flushed_ = 0;
+    uint64_t tail_seq_ = 0;
+    uint32_t flushes_ = 0;
+
+    // Consumer only
+    uint64_t head_seq_ = 0;
+    bool idle_commit_ = false;
+
+    uint64_t scanned_ = 0;
+    uint64_t lost_ = 0;
+
+    std::unique_lock<std::mutex> lock_bus();
+    uint32_t entry_addr(uint64_t pos) const { return base_ + kMetaSize + uint32_t(pos % capacity_) * uint32_t(sizeof(QueueEntry)); }
+    void mount();
+    void format();
+    void write_checkpoint(MR25H40& mram, uint16_t side, uint64_t seqno, uint64_t pos);
+    static bool valid(const QueueCheckpoint& c, uint32_t capacity);
+    static uint32_t checkpoint_crc(const QueueCheckpoint& c);
+    static uint32_t entry_crc(std::span<const uint8_t> raw);
+
+};//class_bureau_queue
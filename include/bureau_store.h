@@ -3,38 +3,405 @@
 #include <optional>
 #include <array>
 #include <cstring>
+#include <cstddef>
+#include <algorithm>
 
 #include "mram_mr25h40.h"
 #include "bureau_codec.h"
+#include "crc32.h"
 
+// Record slot, version 2: header, payload, the running StoreSummary and a
+// trailing commit word (the seqno again) written by a single WRITE. The CRC
+// covers every byte of the record except itself, so a write cut short at any
+// byte fails the check and the other slot still holds the previous record
+// with its summary. Version 1 slots (payload written first, then the header;
+// CRC over the payload only) are still read.
 struct RecordHeader {
     uint32_t magic;
     uint16_t version;
     uint16_t reserved;
     uint32_t length;
-    uint32_t crc32;
+    uint32_t crc32;        // v2: whole record but this field; v1: payload
     uint64_t seqno;
 };
 
 static_assert(sizeof(RecordHeader)==24);
 
-class BureauStore {
+// Running aggregates over every Bureau written through the store, committed
+// inside each record slot, so it always describes exactly the newest record.
+// The integer sums wrap modulo 2^64. A store first written by version 1
+// firmware has no totals for its old records: the summary then starts at
+// the newest version 1 record, carries kRebased and covers first_seqno()
+// to seqno only.
+struct StoreSummary {
+    static constexpr uint16_t kRebased = 1;
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint64_t seqno;        // last record folded in
+    uint64_t count;
+    uint64_t sum_prog;
+    uint64_t sum_math;
+    double   sum_salary;
+    float    min_salary;
+    float    max_salary;
+    uint8_t  min_head;
+    uint8_t  max_head;
+    uint16_t reserved2;
+    uint32_t crc32;        // CRC32 of the preceding 60 bytes
+
+    uint64_t first_seqno() const { return seqno - count + 1; }
+};
+
+static_assert(sizeof(StoreSummary)==64);
+
+template<SpiBackend SpiT>
+class BasicBureauStore {
 
 public:
-    explicit BureauStore(MR25H40& mram);
+    // Slots live at base + the offsets below
+    explicit BasicBureauStore(BasicMR25H40<SpiT>& mram, uint32_t base = 0);
+
+    Result<void> try_write(const Bureau& b);
+    Result<Bureau> try_read();
+    // Summary of the newest record, from the same READ as the record.
+    // NoRecord until the first write, and while the newest record is a
+    // version 1 one (the next write starts a kRebased summary)
+    Result<StoreSummary> try_read_summary();
+    // Seqno of the newest valid record, 0 if there is none
+    uint64_t last_seqno();
+
+#if !MRAM_FREESTANDING
     void write(const Bureau& b);
     Bureau read();
+    StoreSummary read_summary();
+#endif
 
-private:
-    MR25H40& mram_;
-    static constexpr uint32_t MAGIC = 0x45525542; //=BURE
+    // On-device layout and raw slot checks, for tools that walk the device
     static constexpr uint32_t SLOT_SZ = 256;
     static constexpr uint32_t SLOT_A = 0;
     static constexpr uint32_t SLOT_B = SLOT_A + SLOT_SZ;
+    static constexpr uint32_t STORE_SZ = SLOT_B + SLOT_SZ;
+    static constexpr uint32_t SUMMARY_OFF = sizeof(RecordHeader) + BureauCodec::kSize;
+    static constexpr uint32_t COMMIT_OFF = SUMMARY_OFF + sizeof(StoreSummary);
+    static constexpr uint32_t RECORD_SZ = COMMIT_OFF + sizeof(uint64_t);
+    static SlotState check_record_slot(std::span<const uint8_t> raw);
+
+private:
+    BasicMR25H40<SpiT>& mram_;
+    uint32_t base_;
+    static constexpr uint32_t MAGIC = 0x45525542; //=BURE
+    static constexpr uint16_t VERSION = 2;
+    static constexpr uint16_t LEGACY_VERSION = 1;
+    static constexpr uint32_t SUM_MAGIC = 0x4D555342; //=BSUM
+    static constexpr uint16_t SUM_VERSION = 1;
 
-    struct Pick { std::optional<RecordHeader> header; uint32_t base=0; };
-    std::optional<RecordHeader> read_hdr(uint32_t base);
-    static bool choose_slot_for_write(const std::optional<RecordHeader>& a,const std::optional<RecordHeader>& b);
-    Pick pick_best();
+    struct Slot { SlotState state=SlotState::Empty; RecordHeader header{}; std::array<uint8_t,RECORD_SZ> raw{}; };
+    static bool valid_summary(const StoreSummary& s);
+    static void fold(StoreSummary& s, const Bureau& b, uint64_t seqno);
+    std::optional<StoreSummary> summary_of(const Slot& best);
+    static uint32_t record_crc(std::span<const uint8_t> rec);
+    std::array<Slot,2> read_slots();
+    static bool choose_slot_for_write(const Slot& a,const Slot& b);
+    static const Slot& newest(const Slot& a,const Slot& b);
+    Slot pick_best();
 
 };//class_bureau_store
+
+using BureauStore = BasicBureauStore<Spi>;
+
+template<SpiBackend SpiT>
+BasicBureauStore<SpiT>::BasicBureauStore(BasicMR25H40<SpiT>& mram, uint32_t base):mram_(mram),base_(base){}
+
+template<SpiBackend SpiT>
+Result<void> BasicBureauStore<SpiT>::try_write(const Bureau& b) {
+
+    const auto slots = read_slots();
+    const Slot& best = newest(slots[0],slots[1]);
+    const bool have = best.state == SlotState::Valid;
+    const uint64_t next_seq = have ? best.header.seqno + 1 : 1;
+
+    StoreSummary sum{};
+
+    if(auto prev = have ? summary_of(best) : std::nullopt; prev) {
+
+        sum = *prev;
+    } else if(have) {
+
+        // Version 1 record, no totals before it: start over from it and say so
+        sum.flags = StoreSummary::kRebased;
+
+        if(auto old = BureauCodec::try_decode(std::span<const uint8_t,BureauCodec::kSize>(best.raw.data() + sizeof(RecordHeader),BureauCodec::kSize)); old) {
+
+            fold(sum,*old,best.header.seqno);
+        }
+    }
+
+    fold(sum,b,next_seq);
+
+    // Whole record, summary included, built in RAM and committed by one WRITE
+    std::array<uint8_t,RECORD_SZ> rec{};
+    BureauCodec::encode(b,std::span<uint8_t,BureauCodec::kSize>(rec.data() + sizeof(RecordHeader),BureauCodec::kSize));
+    std::memcpy(rec.data() + SUMMARY_OFF,&sum,sizeof(sum));
+    std::memcpy(rec.data() + COMMIT_OFF,&next_seq,sizeof(next_seq));
+
+    RecordHeader h{MAGIC,VERSION,0,uint32_t(BureauCodec::kSize),0,next_seq};
+    std::memcpy(rec.data(),&h,sizeof(h));
+    h.crc32 = record_crc(rec);
+    std::memcpy(rec.data(),&h,sizeof(h));
+
+    const uint32_t off = choose_slot_for_write(slots[0],slots[1])?SLOT_A:SLOT_B;
+
+    return mram_.try_write(base_ + off,rec);
+}
+
+template<SpiBackend SpiT>
+Result<StoreSummary> BasicBureauStore<SpiT>::try_read_summary() {
+
+    const Slot pick = pick_best();
+
+    if(pick.state == SlotState::Empty) {
+
+        return Unexpected{MramErrc::NoRecord};
+    }
+
+    if(pick.state == SlotState::Corrupt) {
+
+        return Unexpected{MramErrc::CrcMismatch};
+    }
+
+    const auto sum = summary_of(pick);
+
+    if(!sum || (!(sum->flags & StoreSummary::kRebased) && sum->count != sum->seqno)) {
+
+        return Unexpected{MramErrc::NoRecord};
+    }
+
+    return *sum;
+}
+
+template<SpiBackend SpiT>
+uint64_t BasicBureauStore<SpiT>::last_seqno() {
+
+    const Slot pick = pick_best();
+
+    return pick.state == SlotState::Valid ? pick.header.seqno : 0;
+}
+
+template<SpiBackend SpiT>
+Result<Bureau> BasicBureauStore<SpiT>::try_read() {
+
+    const Slot pick = pick_best(); 
+    
+    if(pick.state == SlotState::Empty) {
+        
+        return Unexpected{MramErrc::NoRecord};
+    }
+
+    // Neither slot holds a complete record
+    if(pick.state == SlotState::Corrupt) {
+        
+        return Unexpected{MramErrc::CrcMismatch};
+    }
+
+    return BureauCodec::try_decode(std::span<const uint8_t,BureauCodec::kSize>(pick.raw.data() + sizeof(RecordHeader),BureauCodec::kSize));
+}
+
+#if !MRAM_FREESTANDING
+
+template<SpiBackend SpiT>
+void BasicBureauStore<SpiT>::write(const Bureau& b) {
+
+    unwrap(try_write(b));
+}
+
+template<SpiBackend SpiT>
+Bureau BasicBureauStore<SpiT>::read() {
+
+    return unwrap(try_read());
+}
+
+template<SpiBackend SpiT>
+StoreSummary BasicBureauStore<SpiT>::read_summary() {
+
+    return unwrap(try_read_summary());
+}
+
+#endif
+
+template<SpiBackend SpiT>
+std::array<typename BasicBureauStore<SpiT>::Slot,2> BasicBureauStore<SpiT>::read_slots() {
+
+    // Both slots in one READ
+    std::array<uint8_t,SLOT_B - SLOT_A + RECORD_SZ> raw{};
+    std::array<Slot,2> slots{};
+
+    if(!mram_.try_read(base_ + SLOT_A,raw)) {
+
+        return slots;
+    }
+
+    for(size_t k = 0; k < slots.size(); ++k) {
+
+        Slot& slot = slots[k];
+        std::memcpy(slot.raw.data(),raw.data() + k * (SLOT_B - SLOT_A),RECORD_SZ);
+        std::memcpy(&slot.header,slot.raw.data(),sizeof(RecordHeader));
+        slot.state = check_record_slot(slot.raw);
+    }
+
+    return slots;
+}
+
+template<SpiBackend SpiT>
+std::optional<StoreSummary> BasicBureauStore<SpiT>::summary_of(const Slot& best) {
+
+    const uint64_t seqno = best.header.seqno;
+
+    if(best.header.version == VERSION) {
+
+        StoreSummary s{};
+        std::memcpy(&s,best.raw.data() + SUMMARY_OFF,sizeof(s));
+
+        return valid_summary(s) && s.seqno == seqno ? std::optional<StoreSummary>(s) : std::nullopt;
+    }
+
+    // Version 1 records carry no summary
+    return std::nullopt;
+}
+
+template<SpiBackend SpiT>
+uint32_t BasicBureauStore<SpiT>::record_crc(std::span<const uint8_t> rec) {
+
+    constexpr size_t crc_off = offsetof(RecordHeader,crc32);
+    const uint32_t c = Crc32::update(~0u,rec.first(crc_off));
+
+    return Crc32::update(c,rec.subspan(crc_off + sizeof(uint32_t))) ^ ~0u;
+}
+
+template<SpiBackend SpiT>
+bool BasicBureauStore<SpiT>::choose_slot_for_write(const Slot& a,const Slot& b) {
+
+    const bool va = a.state == SlotState::Valid, vb = b.state == SlotState::Valid;
+
+    if(va && vb) {
+        
+        return a.header.seqno <= b.header.seqno;
+    } 
+    
+    if(va) {
+        
+        return false;
+    } 
+    
+    return true;
+}
+template<SpiBackend SpiT>
+const typename BasicBureauStore<SpiT>::Slot& BasicBureauStore<SpiT>::newest(const Slot& a,const Slot& b) {
+
+    const bool va = a.state == SlotState::Valid, vb = b.state == SlotState::Valid;
+
+    if(va && vb) {
+        
+        return (a.header.seqno >= b.header.seqno) ? a : b;
+    }
+
+    if(va) {
+        
+        return a;
+    }
+    
+    if(vb) {
+        
+        return b;
+    } 
+    
+    // Nothing valid: report a corrupt slot over an empty one
+    return a.state == SlotState::Corrupt ? a : b;
+}
+
+template<SpiBackend SpiT>
+typename BasicBureauStore<SpiT>::Slot BasicBureauStore<SpiT>::pick_best() {
+
+    const auto slots = read_slots();
+
+    return newest(slots[0],slots[1]);
+}
+
+template<SpiBackend SpiT>
+SlotState BasicBureauStore<SpiT>::check_record_slot(std::span<const uint8_t> raw) {
+
+    RecordHeader h{};
+
+    if(raw.size() < sizeof(RecordHeader) + BureauCodec::kSize) {
+
+        return SlotState::Corrupt;
+    }
+
+    std::memcpy(&h,raw.data(),sizeof(RecordHeader));
+
+    if(h.magic != MAGIC) {
+
+        return SlotState::Empty;
+    }
+
+    if(h.length != BureauCodec::kSize) {
+
+        return SlotState::Corrupt;
+    }
+
+    if(h.version == LEGACY_VERSION) {
+
+        return Crc32::calc(raw.subspan(sizeof(RecordHeader),BureauCodec::kSize)) == h.crc32 ? SlotState::Valid : SlotState::Corrupt;
+    }
+
+    uint64_t commit = 0;
+
+    if(h.version != VERSION || raw.size() < RECORD_SZ) {
+
+        return SlotState::Corrupt;
+    }
+
+    std::memcpy(&commit,raw.data() + COMMIT_OFF,sizeof(commit));
+
+    if(commit != h.seqno || record_crc(raw.first(RECORD_SZ)) != h.crc32) {
+
+        return SlotState::Corrupt;
+    }
+
+    return SlotState::Valid;
+}
+
+template<SpiBackend SpiT>
+bool BasicBureauStore<SpiT>::valid_summary(const StoreSummary& s) {
+
+    if(s.magic != SUM_MAGIC || s.version != SUM_VERSION) {
+
+        return false;
+    }
+
+    return Crc32::calc(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(&s),offsetof(StoreSummary,crc32))) == s.crc32;
+}
+
+template<SpiBackend SpiT>
+void BasicBureauStore<SpiT>::fold(StoreSummary& s, const Bureau& b, uint64_t seqno) {
+
+    if(s.count == 0) {
+
+        s = StoreSummary{SUM_MAGIC,SUM_VERSION,s.flags,0,0,0,0,0,b.salary_sum,b.salary_sum,b.head_qty,b.head_qty,0,0};
+    }
+
+    s.seqno = seqno;
+    s.count++;
+    s.sum_prog += uint64_t(b.prog_qty);
+    s.sum_math += b.math_qty;
+    s.sum_salary += double(b.salary_sum);
+    s.min_salary = std::min(s.min_salary,b.salary_sum);
+    s.max_salary = std::max(s.max_salary,b.salary_sum);
+    s.min_head = std::min(s.min_head,b.head_qty);
+    s.max_head = std::max(s.max_head,b.head_qty);
+    s.crc32 = Crc32::calc(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(&s),offsetof(StoreSummary,crc32)));
+}
+
+// Virtual-Spi instantiation lives in bureau_store.cpp
+extern template class BasicBureauStore<Spi>;
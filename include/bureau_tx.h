@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <span>
+#include <vector>
+
+#include "mram_mr25h40.h"
+#include "bureau_codec.h"
+#include "bureau_store.h"
+
+// Redo area of BureauTxStore: header, entries and a trailing commit word (the
+// txid again) written by one WRITE. The CRC covers all of it but itself, so
+// a torn commit is simply not there on mount. There are two areas, A and B,
+// taken by txid parity.
+struct RedoHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;        // entries that follow
+    uint64_t txid;
+    uint32_t crc32;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(RedoHeader)==24);
+
+struct RedoEntry {
+    uint32_t key;
+    uint32_t reserved;
+    uint64_t seqno;        // store seqno the key reaches once applied
+    uint8_t  payload[BureauCodec::kSize];
+    uint32_t reserved2;
+};
+
+static_assert(sizeof(RedoEntry)==40);
+
+// Keyed Bureau records, one BureauStore per key, with all-or-nothing
+// multi-key updates:
+//
+//   tx.begin(); tx.put(1, a); tx.put(4, b); tx.commit();
+//
+// commit() writes every staged payload plus the commit record in one WRITE
+// to the redo area of its txid's parity and returns. The records reach their
+// home stores lazily, at the next commit() or apply(); until then read()
+// serves them from RAM. A torn commit only damages the area of the
+// transaction before the last one, already applied, so the last committed
+// txid survives it. On mount the newest valid redo area is taken as pending
+// again. Each entry carries the store seqno it produces, so applying twice
+// after a crash is a no-op.
+class BureauTxStore {
+
+public:
+    static constexpr uint32_t kMaxEntries = 16;
+    static constexpr uint32_t kRedoSize = sizeof(RedoHeader) + kMaxEntries * sizeof(RedoEntry) + sizeof(uint64_t);
+
+    static constexpr uint32_t footprint(uint32_t keys) { return 2 * kRedoSize + keys * BureauStore::STORE_SZ; }
+
+    BureauTxStore(MR25H40& mram, uint32_t base, uint32_t keys);
+
+    void begin();
+    void put(uint32_t key, const Bureau& b);
+    void commit();
+    void rollback();
+    // Writes pending committed records to their home stores
+    void apply();
+
+    Bureau read(uint32_t key);
+
+    bool in_transaction() const { return open_; }
+    uint32_t keys() const { return uint32_t(stores_.size()); }
+    // Never goes back across a remount, whatever byte a commit was cut at
+    uint64_t last_txid() const { return txid_; }
+    size_t pending() const { return pending_.size(); }
+    uint32_t store_base(uint32_t key) const { return base_ + 2 * kRedoSize + key * BureauStore::STORE_SZ; }
+
+private:
+    MR25H40& mram_;
+    uint32_t base_;
+    std::vector<BureauStore> stores_;
+    std::vector<uint64_t> seq_;          // last seqno per home store
+    uint64_t txid_ = 0;
+    static constexpr uint32_t MAGIC = 0x4F444552; //=REDO
+    static constexpr uint16_t VERSION = 2;    // 1: a single redo area
+
+    bool open_ = false;
+    std::vector<std::pair<uint32_t,Bureau>> staged_;
+    std::vector<RedoEntry> pending_;     // committed, not yet applied
+
+    uint32_t redo_addr(uint64_t txid) const { return base_ + uint32_t(txid % 2) * kRedoSize; }
+    void mount();
+    void check_key(uint32_t key) const;
+    static bool valid_redo(std::span<const uint8_t> raw, RedoHeader& h);
+    static uint32_t redo_crc(std::span<const uint8_t> raw, uint16_t count);
+    const RedoEntry* find_pending(uint32_t key) const;
+
+};//class_bureau_tx_store
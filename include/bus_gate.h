@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "spi.h"
+
+enum class BusPriority : uint8_t { Background = 0, Foreground = 1, Critical = 2 };
+
+constexpr size_t kBusPriorities = 3;
+
+// Log2-bucketed histogram; percentile() returns the bucket's upper bound
+class LatencyHistogram {
+
+public:
+    void add(uint64_t v);
+
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+    uint64_t percentile(double p) const;
+    uint64_t bucket(size_t i) const { return buckets_[i]; }
+
+private:
+    std::array<uint64_t,65> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t max_ = 0;
+
+};//class_latency_histogram
+
+// Bus scheduler: serializes SPI transactions between threads. The highest
+// waiting priority class gets the bus next, FIFO within a class, so a
+// lower class never overtakes a waiting higher one. Waits are recorded per
+// class in nanoseconds and in bus bytes clocked by others meanwhile.
+class BusGate {
+
+public:
+    void lock(BusPriority p);
+    void unlock();
+    uint32_t waiting(BusPriority p) const;
+
+    // Called by GatedSpi once each transfer has been clocked out
+    void count_bytes(size_t n) { bytes_ += n; }
+    uint64_t bus_bytes() const { return bytes_; }
+
+    LatencyHistogram wait_ns(BusPriority p) const;
+    LatencyHistogram wait_bytes(BusPriority p) const;
+    void reset_stats();
+
+private:
+    mutable std::mutex m_;
+    std::condition_variable cv_;
+    bool busy_ = false;
+    std::array<uint64_t,kBusPriorities> next_ticket_{};
+    std::array<uint64_t,kBusPriorities> serving_{};
+    std::atomic<uint64_t> bytes_{0};
+    std::array<LatencyHistogram,kBusPriorities> wait_ns_{};
+    std::array<LatencyHistogram,kBusPriorities> wait_bytes_{};
+
+    bool higher_waiting(size_t c) const;
+
+};//class_bus_gate
+
+// Spi decorator taking the gate for each CS-asserted transaction. Every user
+// of a shared bus goes through its own GatedSpi with its priority.
+class GatedSpi final : public Spi {
+
+public:
+    GatedSpi(Spi& bus, BusGate& gate, BusPriority p) : bus_(bus), gate_(gate), prio_(p) {}
+
+    void transfer(std::span<const uint8_t> tx, std::span<uint8_t> rx) override {
+
+        bus_.transfer(tx, rx);
+        gate_.count_bytes(tx.size() > rx.size() ? tx.size() : rx.size());
+    }
+
+    void cs_assert() override { gate_.lock(prio_); bus_.cs_assert(); }
+    void cs_deassert() override { bus_.cs_deassert(); gate_.unlock(); }
+    void delay_us(uint32_t us) override { bus_.delay_us(us); }
+    void set_wp(bool high) override { bus_.set_wp(high); }
+    void set_hold(bool high) override { bus_.set_hold(high); }
+
+private:
+    Spi& bus_;
+    BusGate& gate_;
+    BusPriority prio_;
+
+};//class_gated_spi
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+class Crc32 {
+public:
+
+    static uint32_t calc(std::span<const uint8_t> data) {
+
+        return update(~0u, data) ^ ~0u;
+    }
+
+    // Incremental form: start with ~0u, finish with ^ ~0u
+    static uint32_t update(uint32_t c, std::span<const uint8_t> data) {
+
+        for(uint8_t b : data) {
+            c ^= b;
+
+            for(int i = 0; i < 8; ++i) {
+
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+        }
+
+        return c;
+    }
+
+};//class_crc32
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "spi.h"
+#include "mram_mr25h40.h"
+
+// In-process MR25H40 model for tests and benchmarks.
+//
+// A streaming command state machine: the opcode and address are decoded
+// once per transaction and data moves straight between the transfer and the
+// array with memcpy as it arrives, so long transfers run at memory speed.
+// Device behaviour follows the datasheet:
+//   - WREN/WRDI set and clear WEL; WEL stays set across WRITE and WRSR;
+//   - WRITE and WRSR without WEL are ignored;
+//   - WRITE skips bytes in the BP0/BP1 protected range;
+//   - WRSR is ignored while SRWD is set and WP is low (hardware protection);
+//     it writes bits 7..2 but never WEL;
+//   - READ and WRITE wrap around from the top of the array to 0;
+//   - after SLP every command but WAK is ignored.
+class MR25H40Emulator final : public Spi {
+
+public:
+    MR25H40Emulator();
+    // Operates on caller-owned memory of MR25H40::kSize bytes (a mapped file, ...)
+    explicit MR25H40Emulator(std::span<uint8_t> backing);
+
+    MR25H40Emulator(const MR25H40Emulator&) = delete;
+    MR25H40Emulator& operator=(const MR25H40Emulator&) = delete;
+
+    void transfer(std::span<const uint8_t> tx, std::span<uint8_t> rx) override;
+    void cs_assert() override;
+    void cs_deassert() override;
+    void delay_us(uint32_t) override {}
+    void set_wp(bool high) override { wp_ = high; }
+
+    std::span<uint8_t> memory() { return mem_; }
+    std::span<const uint8_t> memory() const { return mem_; }
+    uint8_t status() const { return sr_; }
+    void set_status(uint8_t sr) { sr_ = sr; }
+    bool sleeping() const { return sleeping_; }
+    size_t transactions() const { return transactions_; }
+
+    // Power-cut simulation: WRITE stores at most `bytes` more data bytes
+    void cut_power_after(size_t bytes) { write_budget_ = bytes; }
+    void restore_power() { write_budget_ = SIZE_MAX; }
+
+private:
+    enum class State : uint8_t { Opcode, Address, Read, Write, Status, WriteStatus, Ignore };
+
+    std::vector<uint8_t> own_;
+    std::span<uint8_t> mem_;
+    uint8_t sr_ = 0;
+    bool wp_ = true;
+    bool sleeping_ = false;
+    bool cs_low_ = false;
+    size_t transactions_ = 0;
+    size_t write_budget_ = SIZE_MAX;
+
+    // Current transaction
+    State state_ = State::Opcode;
+    uint8_t op_ = 0;
+    uint8_t addr_bytes_ = 0;
+    uint32_t addr_ = 0;
+    uint32_t wr_limit_ = 0;        // first protected address, latched per WRITE
+    bool new_sr_valid_ = false;
+    uint8_t new_sr_ = 0;
+
+    void consume(std::span<const uint8_t> tx);
+    void opcode(uint8_t op);
+    void write_data(std::span<const uint8_t> data);
+    void read_data(std::span<uint8_t> out);
+    static void cs_high_error();
+
+};//class_mr25h40_emulator
@@ -0,0 +1,545 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <array>
+#include <map>
+#include <new>
+#include <vector>
+
+#include "mram_mr25h40.h"
+#include "crc32.h"
+
+// Metadata area at the start of an MramHeap region, followed by the page
+// class table (one byte per page, kNoClass if unassigned), the page owner
+// table (two bytes per page) and one bitmap of kBitmapBytes per page. The
+// CRC covers the header fields before it.
+struct HeapHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t classes;
+    uint32_t page_size;
+    uint32_t pages;
+    uint32_t data_off;     // first page, relative to the region base
+    uint32_t crc32;
+};
+
+static_assert(sizeof(HeapHeader)==24);
+
+// On-device size-class allocator.
+//
+// The region is cut into kPageSize pages; a page is given to one size class
+// on first use and carved into equal blocks. Page classes and a bit per
+// block live in the metadata area, so a single one-byte WRITE commits an
+// alloc or free. A page also records the owner tag it was carved for, and
+// only serves allocations with that tag: a client such as RecordStore can
+// tell its own blocks from raw allocations of the same class. Free lists are
+// stacks per class and owner in RAM rebuilt from the bitmap on mount: alloc
+// and free are O(1) (a fresh page is carved into at most kPageSize / 32
+// entries). Pages stay with their class and owner once assigned.
+// Free blocks read as zeros: a fresh page is cleared before it gets a class
+// and free() clears a block before its bit, so a torn write into a new block
+// never meets a previous owner's data.
+template<SpiBackend SpiT>
+class BasicMramHeap {
+
+public:
+    static constexpr uint32_t kPageSize = 4096;
+    static constexpr std::array<uint32_t,13> kClasses{32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048};
+    static constexpr uint32_t kBitmapBytes = kPageSize / kClasses[0] / 8;
+    static constexpr uint8_t kNoClass = 0xFF;
+    static constexpr uint16_t kNoOwner = 0;
+
+    // Smallest class holding `bytes`, kClasses.size() if none does
+    static constexpr size_t size_class(size_t bytes) {
+
+        size_t c = 0;
+
+        while(c < kClasses.size() && kClasses[c] < bytes) {
+
+            ++c;
+        }
+
+        return c;
+    }
+
+    // Lays out [base, base+size) without touching the device; try_mount()
+    // reads it, formatting it if no valid header is found. A region that
+    // does not fit the device or holds no page has pages() == 0 and fails
+    // to mount with BadArgument
+    BasicMramHeap(BasicMR25H40<SpiT>& mram, uint32_t base, uint32_t size, std::nothrow_t);
+    Result<void> try_mount();
+
+    // Device address of a free block of at least `bytes` on a page of
+    // `owner`; Overflow when the class and the free pages are exhausted,
+    // BadArgument when no class holds `bytes`
+    Result<uint32_t> try_alloc(size_t bytes, uint16_t owner = kNoOwner);
+    Result<void> try_free(uint32_t addr);
+    Result<uint32_t> try_block_size(uint32_t addr) const;
+    Result<uint16_t> try_owner(uint32_t addr) const;
+
+#if !MRAM_FREESTANDING
+    // Mounts the heap in [base, base+size)
+    BasicMramHeap(BasicMR25H40<SpiT>& mram, uint32_t base, uint32_t size);
+
+    uint32_t alloc(size_t bytes, uint16_t owner = kNoOwner);
+    void free(uint32_t addr);
+    uint32_t block_size(uint32_t addr) const;
+    uint16_t owner(uint32_t addr) const;
+#endif
+
+    bool allocated(uint32_t addr) const;
+
+    // Every allocated block: f(addr, block_size)
+    template<class F>
+    void for_each_allocated(F&& f) const {
+
+        for(uint32_t p = 0; p < pages_; ++p) {
+
+            if(class_of_[p] == kNoClass) {
+
+                continue;
+            }
+
+            const uint32_t bs = kClasses[class_of_[p]];
+
+            for(uint32_t b = 0; b < kPageSize / bs; ++b) {
+
+                if(bit(p,b)) {
+
+                    f(page_addr(p) + b * bs, bs);
+                }
+            }
+        }
+    }
+
+    uint32_t pages() const { return pages_; }
+    uint32_t free_pages() const { return uint32_t(free_pages_.size()); }
+    uint32_t data_base() const { return base_ + data_off_; }
+    size_t used_blocks() const { return used_; }
+
+private:
+    BasicMR25H40<SpiT>& mram_;
+    uint32_t base_;
+    uint32_t pages_;
+    uint32_t data_off_;
+    static constexpr uint32_t MAGIC = 0x50414548; //=HEAP
+    static constexpr uint16_t VERSION = 1;
+    static constexpr uint32_t kPageMeta = 1 + sizeof(uint16_t) + kBitmapBytes;
+
+    // RAM mirror of the metadata after the header
+    std::vector<uint8_t> class_of_;
+    std::vector<uint16_t> owner_of_;
+    std::vector<uint8_t> bitmap_;
+    std::map<uint32_t,std::vector<uint32_t>> free_;   // free block addresses per list_key(class, owner)
+    std::vector<uint32_t> free_pages_;
+    size_t used_ = 0;
+
+    struct Loc { uint32_t page; uint32_t block; };
+
+    uint32_t page_addr(uint32_t p) const { return base_ + data_off_ + p * kPageSize; }
+    uint32_t class_off() const { return sizeof(HeapHeader); }
+    uint32_t owner_off() const { return class_off() + pages_; }
+    uint32_t bitmap_off() const { return owner_off() + pages_ * uint32_t(sizeof(uint16_t)); }
+    static uint32_t list_key(size_t cls, uint16_t owner) { return uint32_t(owner) << 8 | uint32_t(cls); }
+    bool bit(uint32_t p, uint32_t b) const { return bitmap_[p * kBitmapBytes + b / 8] & (1u << (b % 8)); }
+
+    static constexpr uint32_t meta_size(uint32_t pages) { return uint32_t(sizeof(HeapHeader)) + pages * kPageMeta; }
+    static constexpr uint32_t round_up(uint32_t v, uint32_t a) { return (v + a - 1) / a * a; }
+    static uint32_t header_crc(const HeapHeader& h);
+
+    Result<void> format();
+    Result<void> carve(uint32_t page, size_t cls, uint16_t owner);
+    Result<Loc> locate(uint32_t addr) const;
+    Result<void> set_bit(uint32_t p, uint32_t b, bool on);
+    Result<void> fill(uint32_t addr, size_t len, uint8_t pattern);
+
+};//class_mram_heap
+
+using MramHeap = BasicMramHeap<Spi>;
+
+template<SpiBackend SpiT>
+BasicMramHeap<SpiT>::BasicMramHeap(BasicMR25H40<SpiT>& mram, uint32_t base, uint32_t size, std::nothrow_t)
+    : mram_(mram), base_(base), pages_(0), data_off_(0) {
+
+    if(base > MR25H40Defs::kSize || size > MR25H40Defs::kSize - base) {
+
+        return;
+    }
+
+    pages_ = size / (kPageSize + kPageMeta);
+
+    while(pages_ > 0 && round_up(meta_size(pages_),64) + pages_ * kPageSize > size) {
+
+        --pages_;
+    }
+
+    data_off_ = pages_ == 0 ? 0 : round_up(meta_size(pages_),64);
+}
+
+template<SpiBackend SpiT>
+Result<void> BasicMramHeap<SpiT>::try_mount() {
+
+    if(pages_ == 0) {
+
+        return Unexpected{MramErrc::BadArgument};
+    }
+
+    free_.clear();
+    free_pages_.clear();
+    used_ = 0;
+
+    std::array<uint8_t,sizeof(HeapHeader)> hb{};
+
+    if(auto r = mram_.try_read(base_,hb); !r) {
+
+        return r;
+    }
+
+    HeapHeader h{};
+    std::memcpy(&h,hb.data(),sizeof(h));
+
+    if(h.magic != MAGIC || h.version != VERSION || h.crc32 != header_crc(h) || h.classes != kClasses.size() ||
+       h.page_size != kPageSize || h.pages != pages_ || h.data_off != data_off_) {
+
+        return format();
+    }
+
+    // Class table, owner table and bitmaps are adjacent: one READ
+    std::vector<uint8_t> meta(pages_ * kPageMeta);
+
+    if(auto r = mram_.try_read(base_ + class_off(),meta); !r) {
+
+        return r;
+    }
+
+    class_of_.assign(meta.begin(),meta.begin() + pages_);
+    owner_of_.resize(pages_);
+    std::memcpy(owner_of_.data(),meta.data() + pages_,pages_ * sizeof(uint16_t));
+    bitmap_.assign(meta.begin() + (bitmap_off() - class_off()),meta.end());
+
+    for(uint32_t i = pages_; i-- > 0; ) {
+
+        if(class_of_[i] >= kClasses.size()) {
+
+            // Unassigned (or unreadable class): its owner and bits are meaningless
+            class_of_[i] = kNoClass;
+            owner_of_[i] = kNoOwner;
+            std::memset(bitmap_.data() + i * kBitmapBytes,0,kBitmapBytes);
+            free_pages_.push_back(i);
+            continue;
+        }
+
+        const uint32_t bs = kClasses[class_of_[i]];
+        auto& list = free_[list_key(class_of_[i],owner_of_[i])];
+
+        for(uint32_t b = kPageSize / bs; b-- > 0; ) {
+
+            if(bit(i,b)) {
+
+                used_++;
+            } else {
+
+                list.push_back(page_addr(i) + b * bs);
+            }
+        }
+    }
+
+    return {};
+}
+
+template<SpiBackend SpiT>
+Result<uint32_t> BasicMramHeap<SpiT>::try_alloc(size_t bytes, uint16_t owner) {
+
+    const size_t cls = size_class(bytes);
+
+    if(cls == kClasses.size()) {
+
+        return Unexpected{MramErrc::BadArgument};
+    }
+
+    auto& list = free_[list_key(cls,owner)];
+
+    if(list.empty()) {
+
+        if(free_pages_.empty()) {
+
+            return Unexpected{MramErrc::Overflow};
+        }
+
+        if(auto r = carve(free_pages_.back(),cls,owner); !r) {
+
+            return Unexpected{r.error()};
+        }
+
+        free_pages_.pop_back();
+    }
+
+    const uint32_t addr = list.back();
+    const Loc l = locate(addr).value();
+
+    if(auto r = set_bit(l.page,l.block,true); !r) {
+
+        return Unexpected{r.error()};
+    }
+
+    list.pop_back();
+    used_++;
+
+    return addr;
+}
+
+template<SpiBackend SpiT>
+Result<void> BasicMramHeap<SpiT>::try_free(uint32_t addr) {
+
+    const Result<Loc> l = locate(addr);
+
+    if(!l) {
+
+        return Unexpected{l.error()};
+    }
+
+    if(!bit(l->page,l->block)) {
+
+        return Unexpected{MramErrc::BadArgument};
+    }
+
+    const uint8_t cls = class_of_[l->page];
+
+    if(auto r = fill(addr,kClasses[cls],0); !r) {
+
+        return r;
+    }
+
+    if(auto r = set_bit(l->page,l->block,false); !r) {
+
+        return r;
+    }
+
+    free_[list_key(cls,owner_of_[l->page])].push_back(addr);
+    used_--;
+
+    return {};
+}
+
+template<SpiBackend SpiT>
+bool BasicMramHeap<SpiT>::allocated(uint32_t addr) const {
+
+    const Result<Loc> l = locate(addr);
+
+    return l && bit(l->page,l->block);
+}
+
+template<SpiBackend SpiT>
+Result<uint32_t> BasicMramHeap<SpiT>::try_block_size(uint32_t addr) const {
+
+    const Result<Loc> l = locate(addr);
+
+    if(!l) {
+
+        return Unexpected{l.error()};
+    }
+
+    return kClasses[class_of_[l->page]];
+}
+
+template<SpiBackend SpiT>
+Result<uint16_t> BasicMramHeap<SpiT>::try_owner(uint32_t addr) const {
+
+    const Result<Loc> l = locate(addr);
+
+    if(!l) {
+
+        return Unexpected{l.error()};
+    }
+
+    return owner_of_[l->page];
+}
+
+#if !MRAM_FREESTANDING
+
+template<SpiBackend SpiT>
+BasicMramHeap<SpiT>::BasicMramHeap(BasicMR25H40<SpiT>& mram, uint32_t base, uint32_t size)
+    : BasicMramHeap(mram,base,size,std::nothrow) {
+
+    unwrap(try_mount());
+}
+
+template<SpiBackend SpiT>
+uint32_t BasicMramHeap<SpiT>::alloc(size_t bytes, uint16_t owner) {
+
+    return unwrap(try_alloc(bytes,owner));
+}
+
+template<SpiBackend SpiT>
+void BasicMramHeap<SpiT>::free(uint32_t addr) {
+
+    unwrap(try_free(addr));
+}
+
+template<SpiBackend SpiT>
+uint32_t BasicMramHeap<SpiT>::block_size(uint32_t addr) const {
+
+    return unwrap(try_block_size(addr));
+}
+
+template<SpiBackend SpiT>
+uint16_t BasicMramHeap<SpiT>::owner(uint32_t addr) const {
+
+    return unwrap(try_owner(addr));
+}
+
+#endif
+
+template<SpiBackend SpiT>
+uint32_t BasicMramHeap<SpiT>::header_crc(const HeapHeader& h) {
+
+    return Crc32::calc(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(&h),offsetof(HeapHeader,crc32)));
+}
+
+template<SpiBackend SpiT>
+Result<void> BasicMramHeap<SpiT>::format() {
+
+    class_of_.assign(pages_,kNoClass);
+    owner_of_.assign(pages_,kNoOwner);
+    bitmap_.assign(size_t(pages_) * kBitmapBytes,0);
+
+    // Tables first, header last: a cut format is simply redone
+    if(auto r = fill(base_ + class_off(),pages_,kNoClass); !r) {
+
+        return r;
+    }
+
+    if(auto r = fill(base_ + owner_off(),pages_ * sizeof(uint16_t) + bitmap_.size(),0); !r) {
+
+        return r;
+    }
+
+    HeapHeader h{MAGIC,VERSION,uint16_t(kClasses.size()),kPageSize,pages_,data_off_,0};
+    h.crc32 = header_crc(h);
+
+    std::array<uint8_t,sizeof(HeapHeader)> hb{};
+    std::memcpy(hb.data(),&h,sizeof(h));
+
+    if(auto r = mram_.try_write(base_,hb); !r) {
+
+        return r;
+    }
+
+    for(uint32_t i = pages_; i-- > 0; ) {
+
+        free_pages_.push_back(i);
+    }
+
+    return {};
+}
+
+template<SpiBackend SpiT>
+Result<void> BasicMramHeap<SpiT>::carve(uint32_t page, size_t cls, uint16_t owner) {
+
+    // Page contents, bits and owner are on the device before it gets a class
+    if(auto r = fill(page_addr(page),kPageSize,0); !r) {
+
+        return r;
+    }
+
+    if(auto r = fill(base_ + bitmap_off() + page * kBitmapBytes,kBitmapBytes,0); !r) {
+
+        return r;
+    }
+
+    std::memset(bitmap_.data() + page * kBitmapBytes,0,kBitmapBytes);
+
+    if(auto r = mram_.try_write(base_ + owner_off() + page * uint32_t(sizeof(uint16_t)),std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(&owner),sizeof(owner))); !r) {
+
+        return r;
+    }
+
+    owner_of_[page] = owner;
+
+    const auto c = uint8_t(cls);
+
+    if(auto r = mram_.try_write(base_ + class_off() + page,std::span<const uint8_t>(&c,1)); !r) {
+
+        return r;
+    }
+
+    class_of_[page] = c;
+
+    const uint32_t bs = kClasses[cls];
+
+    auto& list = free_[list_key(cls,owner)];
+
+    for(uint32_t b = kPageSize / bs; b-- > 0; ) {
+
+        list.push_back(page_addr(page) + b * bs);
+    }
+
+    return {};
+}
+
+template<SpiBackend SpiT>
+Result<typename BasicMramHeap<SpiT>::Loc> BasicMramHeap<SpiT>::locate(uint32_t addr) const {
+
+    if(addr < data_base() || addr >= data_base() + pages_ * kPageSize) {
+
+        return Unexpected{MramErrc::BadArgument};
+    }
+
+    const uint32_t page = (addr - data_base()) / kPageSize;
+
+    if(class_of_[page] == kNoClass) {
+
+        return Unexpected{MramErrc::BadArgument};
+    }
+
+    const uint32_t bs = kClasses[class_of_[page]];
+    const uint32_t off = addr - page_addr(page);
+
+    if(off % bs != 0 || off / bs >= kPageSize / bs) {
+
+        return Unexpected{MramErrc::BadArgument};
+    }
+
+    return Loc{page,off / bs};
+}
+
+template<SpiBackend SpiT>
+Result<void> BasicMramHeap<SpiT>::set_bit(uint32_t p, uint32_t b, bool on) {
+
+    // RAM mirror follows the device: a failed WRITE changes nothing
+    uint8_t& byte = bitmap_[p * kBitmapBytes + b / 8];
+    const auto next = on ? uint8_t(byte | (1u << (b % 8))) : uint8_t(byte & ~(1u << (b % 8)));
+
+    if(auto r = mram_.try_write(base_ + bitmap_off() + p * kBitmapBytes + b / 8,std::span<const uint8_t>(&next,1)); !r) {
+
+        return r;
+    }
+
+    byte = next;
+
+    return {};
+}
+
+template<SpiBackend SpiT>
+Result<void> BasicMramHeap<SpiT>::fill(uint32_t addr, size_t len, uint8_t pattern) {
+
+    // A short fill ran into the write-protected region
+    const Result<size_t> r = mram_.try_fill(addr,len,pattern);
+
+    if(!r) {
+
+        return Unexpected{r.error()};
+    }
+
+    if(r.value() != len) {
+
+        return Unexpected{MramErrc::OutOfRange};
+    }
+
+    return {};
+}
+
+// Virtual-Spi instantiation lives in mram_heap.cpp
+extern template class BasicMramHeap<Spi>;
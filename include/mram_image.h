@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mram_mr25h40.h"
+
+// Whole-device image file: ImageHeader followed by kSize data bytes.
+// The CRC covers the data; the status register is kept so block protection
+// comes back with the contents.
+struct ImageHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t  sr;
+    uint8_t  reserved;
+    uint32_t size;         // data bytes that follow
+    uint32_t crc32;        // CRC32 of the data
+};
+
+static_assert(sizeof(ImageHeader)==16);
+
+// Image file mapped read-only (mmap where available). The header is checked
+// on open and the data CRC by verify(), so a loaded fixture is never half
+// garbage.
+class MramImageFile {
+
+public:
+    explicit MramImageFile(const std::string& path);
+    ~MramImageFile();
+
+    MramImageFile(const MramImageFile&) = delete;
+    MramImageFile& operator=(const MramImageFile&) = delete;
+
+    const ImageHeader& header() const { return hdr_; }
+    std::span<const uint8_t> data() const { return {base_ + sizeof(ImageHeader), hdr_.size}; }
+    bool verify() const;
+
+private:
+    const uint8_t* base_ = nullptr;
+    size_t len_ = 0;
+    bool mapped_ = false;
+    std::vector<uint8_t> copy_;      // where mmap is not available
+    ImageHeader hdr_{};
+
+    void unmap();
+
+};//class_mram_image_file
+
+namespace MramImage {
+
+    constexpr uint32_t kMagic = 0x474D494D; //=MIMG
+    constexpr uint16_t kVersion = 1;
+    constexpr size_t kChunk = 64 * 1024;
+
+    // Whole array with one streaming READ plus the status register
+    void dump(MR25H40& mram, const std::string& path, size_t chunk = kChunk);
+
+    // Writes an image back: block protection off, data in WRITEs of `chunk`
+    // bytes, a streaming read-back checked against the image CRC, then the
+    // saved status register. Throws before touching the device if the file
+    // is not a valid image, and throws if the status register does not take
+    // (SRWD set with WP low) or the read-back differs. A restored SRWD locks
+    // the register again, so a later load needs WP high.
+    void load(MR25H40& mram, const std::string& path, size_t chunk = kChunk);
+
+    // Direct load for in-memory backends: copies the mapped image into `mem`
+    // and returns the saved status register for the caller to apply.
+    uint8_t load_into(std::span<uint8_t> mem, const std::string& path);
+
+}//ns_mram_image
@@ -3,14 +3,34 @@
 #include <cstdint>
 #include <span>
 #include <array>
+#include <cstring>
+#include <optional>
+
+#include "spi.h"
+#include "mram_result.h"
+
+#include <algorithm>
+
+#if !MRAM_FREESTANDING
 #include <vector>
 #include <stdexcept>
+#include <functional>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+#endif
 
-#include "spi.h"
+// One range of a vectored read: [addr, addr + out.size()) lands in out
+struct ReadRequest {
+    uint32_t addr;
+    std::span<uint8_t> out;
+};
 
-class MR25H40 {
+// Opcodes, SR bits and geometry, shared by every backend instantiation
+struct MR25H40Defs {
 
-public:
     static constexpr uint32_t kSize = 512 * 1024; //512Kib
     static constexpr uint8_t WREN = 0x06, WRDI = 0x04;
     static constexpr uint8_t RDSR = 0x05, WRSR = 0x01;
@@ -21,11 +41,76 @@ public:
     static constexpr uint8_t SR_BP1 = 0x08;   // Bit 3: Block Protect 1
     static constexpr uint8_t SR_WD = 0x80;    // Bit 7: Status Register Write Disable (SRWD)
 
-    explicit MR25H40(Spi& spi);
+    enum class Protect { None, UpperQuarter, UpperHalf, All };
+
+    // A new READ costs a 4-byte header plus a CS cycle, so gaps up to about
+    // this many bytes are cheaper to clock through than to skip
+    static constexpr size_t kDefaultCoalesceGap = 8;
+
+    // First address covered by the BP0/BP1 bits of sr (kSize if none)
+    static constexpr uint32_t protected_start(uint8_t sr) {
+
+        switch (sr & (SR_BP0 | SR_BP1)) {
+            case SR_BP0:          return kSize - kSize / 4;
+            case SR_BP1:          return kSize / 2;
+            case SR_BP0 | SR_BP1: return 0;
+            default:              return kSize;
+        }
+    }
+
+    static constexpr bool in_range(uint32_t addr, size_t len) {
+
+        return addr < kSize && len <= (kSize - addr);
+    }
+
+};//struct_mr25h40_defs
+
+// Driver parameterized on the concrete SPI backend: with a final backend
+// type every bus call can be inlined. MR25H40 below keeps the virtual Spi.
+template<SpiBackend SpiT>
+class BasicMR25H40 : public MR25H40Defs {
+
+public:
+    explicit BasicMR25H40(SpiT& spi);
 
     void power_up_delay();
+
+    // Non-throwing core, the only data path in the freestanding profile
+    Result<void> try_read(uint32_t addr, std::span<uint8_t> out);
+    Result<void> try_write(uint32_t addr, std::span<const uint8_t> in);
+
+    // Writes `pattern` over [addr, addr+len) in one WRITE transaction (or
+    // max_transfer() sized ones), streamed
+    // from a small stack buffer. The BP-protected upper region is skipped;
+    // returns the number of bytes actually written.
+    Result<size_t> try_fill(uint32_t addr, size_t len, uint8_t pattern);
+
+    // Vectored read: ranges are sorted, ranges that overlap or lie within
+    // coalesce_gap() bytes of each other share one READ (gap bytes are
+    // clocked through and dropped), and results are scattered into each
+    // request's buffer. Merged READs stay within max_transfer(). Requests are
+    // sorted in groups of kReadManyGroup without heap; the last READ of a
+    // group stays open and the next group continues it when its lowest
+    // request starts at or just past where that READ stopped (ascending
+    // input: one READ whatever the count). Ranges that fall below it start
+    // a new READ. Returns the number of READ transactions issued.
+    Result<size_t> try_read_many(std::span<const ReadRequest> reqs);
+
+#if !MRAM_FREESTANDING
     void read(uint32_t addr, std::span<uint8_t> out);
+    size_t read_many(std::span<const ReadRequest> reqs);
+
+    // Reads [addr, addr+len) in one READ transaction, handing each filled chunk
+    // to cb on a worker thread while the next chunk is clocked in (nbufs >= 2
+    // buffers of `chunk` bytes). Chunks arrive in address order.
+    using StreamCallback = std::function<void(uint32_t addr, std::span<const uint8_t> data)>;
+    void read_stream(uint32_t addr, size_t len, size_t chunk, const StreamCallback& cb, size_t nbufs = 2);
+
     void write(uint32_t addr, std::span<const uint8_t> in);
+    size_t fill(uint32_t addr, size_t len, uint8_t pattern);
+    size_t erase_all(uint8_t pattern = 0x00);
+#endif
+
     uint8_t read_status();
     void write_status(uint8_t sr);
     void write_enable();
@@ -33,11 +118,517 @@ public:
     void sleep();
     void wake();
 
-    enum class Protect { None, UpperQuarter, UpperHalf, All };
     void set_block_protect(Protect p, bool hw_lock = false);
 
+    // Caps the data bytes per READ/WRITE transaction (0 = no cap). MRAM has no
+    // pages, so long transfers split freely; on a shared bus this bounds how
+    // long others wait for CS. A split read is no longer one atomic snapshot.
+    // read_stream is not split.
+    void set_max_transfer(size_t bytes) { max_xfer_ = bytes; }
+    size_t max_transfer() const { return max_xfer_; }
+
+    void set_coalesce_gap(size_t bytes) { gap_ = bytes; }
+    size_t coalesce_gap() const { return gap_; }
+
+    static constexpr size_t kReadManyGroup = 64;
+
 private:
-    Spi& spi_;
-    static void check_range(uint32_t addr, size_t len);
+    using CsGuardT = BasicCsGuard<SpiT>;
+    SpiT& spi_;
+    size_t max_xfer_ = 0;
+    size_t gap_ = kDefaultCoalesceGap;
+
+    void read_run(std::span<const ReadRequest> group, std::span<const uint8_t> order, uint32_t& cursor);
+
+    size_t piece(size_t remaining) const { return max_xfer_ ? std::min(max_xfer_, remaining) : remaining; }
 
 };//class_mr25h40
+
+using MR25H40 = BasicMR25H40<Spi>;
+
+template<SpiBackend SpiT>
+BasicMR25H40<SpiT>::BasicMR25H40(SpiT& spi) : spi_(spi) {}
+
+template<SpiBackend SpiT>
+void BasicMR25H40<SpiT>::power_up_delay() { 
+    
+    spi_.delay_us(400); 
+}
+
+template<SpiBackend SpiT>
+Result<void> BasicMR25H40<SpiT>::try_read(uint32_t addr, std::span<uint8_t> out) {
+
+    if (!in_range(addr, out.size())) {
+
+        return Unexpected{MramErrc::OutOfRange};
+    }
+
+    size_t off = 0;
+
+    do {
+
+        const size_t n = piece(out.size() - off);
+        const uint32_t a = addr + uint32_t(off);
+        std::array<uint8_t,4> hdr{READ, uint8_t(a>>16), uint8_t(a>>8), uint8_t(a)};
+        CsGuardT cs(spi_);
+        spi_.transfer(hdr, {});
+        spi_.transfer({}, out.subspan(off, n));
+        off += n;
+    } while (off < out.size());
+
+    return {};
+}
+
+template<SpiBackend SpiT>
+Result<void> BasicMR25H40<SpiT>::try_write(uint32_t addr, std::span<const uint8_t> in) {
+
+    if (!in_range(addr, in.size())) {
+
+        return Unexpected{MramErrc::OutOfRange};
+    }
+
+    size_t off = 0;
+
+    do {
+
+        const size_t n = piece(in.size() - off);
+        const uint32_t a = addr + uint32_t(off);
+        write_enable();
+        std::array<uint8_t,4> hdr{WRITE, uint8_t(a>>16), uint8_t(a>>8), uint8_t(a)};
+        CsGuardT cs(spi_);
+        spi_.transfer(hdr, {});
+        spi_.transfer(in.subspan(off, n), {});
+        off += n;
+    } while (off < in.size());
+
+    return {};
+}
+
+template<SpiBackend SpiT>
+Result<size_t> BasicMR25H40<SpiT>::try_fill(uint32_t addr, size_t len, uint8_t pattern) {
+
+    if (!in_range(addr, len)) {
+
+        return Unexpected{MramErrc::OutOfRange};
+    }
+
+    // Protection always covers an upper region, so only the tail is cut off
+    const uint32_t prot = protected_start(read_status());
+    const size_t n = addr >= prot ? 0 : std::min<size_t>(len, prot - addr);
+
+    if (n == 0) {
+
+        return size_t{0};
+    }
+
+    std::array<uint8_t,256> pat;
+    pat.fill(pattern);
+
+    for (size_t off = 0; off < n; ) {
+
+        const size_t end = off + piece(n - off);
+        const uint32_t a = addr + uint32_t(off);
+        write_enable();
+        std::array<uint8_t,4> hdr{WRITE, uint8_t(a>>16), uint8_t(a>>8), uint8_t(a)};
+        CsGuardT cs(spi_);
+        spi_.transfer(hdr, {});
+
+        for (; off < end; off += std::min(pat.size(), end - off)) {
+
+            spi_.transfer(std::span<const uint8_t>(pat.data(), std::min(pat.size(), end - off)), {});
+        }
+    }
+
+    return n;
+}
+
+template<SpiBackend SpiT>
+Result<size_t> BasicMR25H40<SpiT>::try_read_many(std::span<const ReadRequest> reqs) {
+
+    for (const auto& r : reqs) {
+
+        if (!in_range(r.addr, r.out.size())) {
+
+            return Unexpected{MramErrc::OutOfRange};
+        }
+    }
+
+    size_t reads = 0;
+
+    // READ still clocking at the end of the previous group
+    std::optional<CsGuardT> open;
+    uint32_t open_start = 0, cursor = 0;
+
+    for (size_t g = 0; g < reqs.size(); g += kReadManyGroup) {
+
+        const auto group = reqs.subspan(g, std::min(kReadManyGroup, reqs.size() - g));
+        std::array<uint8_t,kReadManyGroup> order{};
+        size_t n = 0;
+
+        for (size_t i = 0; i < group.size(); ++i) {
+
+            if (!group[i].out.empty()) {
+
+                order[n++] = uint8_t(i);
+            }
+        }
+
+        std::sort(order.begin(), order.begin() + n, [&](uint8_t a, uint8_t b) { return group[a].addr < group[b].addr; });
+
+        for (size_t first = 0; first < n; ) {
+
+            const auto& head = group[order[first]];
+            const uint32_t head_end = head.addr + uint32_t(head.out.size());
+
+            // Bytes already clocked out cannot be had again from this READ
+            const bool carry = open && head.addr >= cursor && head.addr <= cursor + gap_ &&
+                               (!max_xfer_ || head_end - open_start <= max_xfer_);
+
+            if (!carry) {
+
+                open.reset();
+            }
+
+            const uint32_t start = carry ? open_start : head.addr;
+            uint32_t end = head_end;
+            size_t last = first + 1;
+
+            for (; last < n; ++last) {
+
+                const auto& r = group[order[last]];
+                const uint32_t r_end = std::max(end, r.addr + uint32_t(r.out.size()));
+
+                if (r.addr > end + gap_ || (max_xfer_ && r_end - start > max_xfer_)) {
+
+                    break;
+                }
+
+                end = r_end;
+            }
+
+            // The group's last run may be continued by the next group
+            const bool tail = last == n && g + kReadManyGroup < reqs.size();
+
+            if (!carry && last - first == 1 && !(tail && (!max_xfer_ || head.out.size() <= max_xfer_))) {
+
+                // Alone in its run: the plain path, split by max_transfer()
+                const size_t len = head.out.size();
+                (void)try_read(start, head.out);
+                reads += max_xfer_ ? (len + max_xfer_ - 1) / max_xfer_ : 1;
+            } else {
+
+                if (!carry) {
+
+                    std::array<uint8_t,4> hdr{READ, uint8_t(start>>16), uint8_t(start>>8), uint8_t(start)};
+                    open.emplace(spi_);
+                    spi_.transfer(hdr, {});
+                    open_start = cursor = start;
+                    reads++;
+                }
+
+                read_run(group, std::span<const uint8_t>(order.data() + first, last - first), cursor);
+
+                if (!tail) {
+
+                    open.reset();
+                }
+            }
+
+            first = last;
+        }
+    }
+
+    return reads;
+}
+
+// Clocks the requests of a run, in address order, out of the READ already
+// open at cursor
+template<SpiBackend SpiT>
+void BasicMR25H40<SpiT>::read_run(std::span<const ReadRequest> group, std::span<const uint8_t> order, uint32_t& cursor) {
+
+    std::array<uint8_t,32> skip;
+
+    for (size_t k = 0; k < order.size(); ++k) {
+
+        const auto& r = group[order[k]];
+        const uint32_t r_end = r.addr + uint32_t(r.out.size());
+
+        while (cursor < r.addr) {
+
+            const size_t n = std::min<size_t>(skip.size(), r.addr - cursor);
+            spi_.transfer({}, std::span<uint8_t>(skip.data(), n));
+            cursor += uint32_t(n);
+        }
+
+        // Bytes below the cursor were clocked into earlier requests
+        for (size_t j = 0; j < k && r.addr < cursor; ++j) {
+
+            const auto& p = group[order[j]];
+            const uint32_t lo = std::max(r.addr, p.addr);
+            const uint32_t hi = std::min({cursor, r_end, p.addr + uint32_t(p.out.size())});
+
+            if (lo < hi) {
+
+                std::memcpy(r.out.data() + (lo - r.addr), p.out.data() + (lo - p.addr), hi - lo);
+            }
+        }
+
+        if (r_end > cursor) {
+
+            spi_.transfer({}, r.out.subspan(cursor - r.addr));
+            cursor = r_end;
+        }
+    }
+}
+
+#if !MRAM_FREESTANDING
+
+template<SpiBackend SpiT>
+void BasicMR25H40<SpiT>::read(uint32_t addr, std::span<uint8_t> out) {
+    
+    unwrap(try_read(addr, out));
+}
+
+template<SpiBackend SpiT>
+size_t BasicMR25H40<SpiT>::read_many(std::span<const ReadRequest> reqs) {
+
+    return unwrap(try_read_many(reqs));
+}
+
+template<SpiBackend SpiT>
+void BasicMR25H40<SpiT>::read_stream(uint32_t addr, size_t len, size_t chunk, const StreamCallback& cb, size_t nbufs) {
+
+    if (!in_range(addr, len)) {
+
+        throw_error(MramErrc::OutOfRange);
+    }
+
+    if (chunk == 0 || nbufs < 2) {
+
+        throw std::invalid_argument("MR25H40: stream buffers");
+    }
+
+    if (len == 0) {
+
+        return;
+    }
+
+    chunk = std::min(chunk, len);
+
+    struct Filled { size_t buf; uint32_t addr; size_t n; };
+
+    std::vector<uint8_t> pool(chunk * nbufs);
+    std::deque<size_t> free_bufs;
+    std::deque<Filled> filled;
+    std::mutex m;
+    std::condition_variable cv;
+    bool done = false;
+    std::exception_ptr err;
+
+    for (size_t i = 0; i < nbufs; ++i) {
+
+        free_bufs.push_back(i);
+    }
+
+    // Consumer: decodes chunk N while the bus fills chunk N+1
+    std::thread consumer([&] {
+
+        for (;;) {
+
+            Filled f{};
+
+            {
+                std::unique_lock lk(m);
+                cv.wait(lk, [&] { return !filled.empty() || done; });
+
+                if (filled.empty()) {
+
+                    return;
+                }
+
+                f = filled.front();
+                filled.pop_front();
+            }
+
+            try {
+
+                cb(f.addr, std::span<const uint8_t>(pool.data() + f.buf * chunk, f.n));
+            } catch (...) {
+
+                std::lock_guard lk(m);
+                err = std::current_exception();
+                cv.notify_all();
+                return;
+            }
+
+            {
+                std::lock_guard lk(m);
+                free_bufs.push_back(f.buf);
+            }
+
+            cv.notify_all();
+        }
+    });
+
+    try {
+
+        std::array<uint8_t,4> hdr{READ, uint8_t(addr>>16), uint8_t(addr>>8), uint8_t(addr)};
+        CsGuardT cs(spi_);
+        spi_.transfer(hdr, {});
+
+        for (size_t off = 0; off < len; off += chunk) {
+
+            size_t b = 0;
+
+            {
+                std::unique_lock lk(m);
+                cv.wait(lk, [&] { return !free_bufs.empty() || err; });
+
+                if (err) {
+
+                    break;
+                }
+
+                b = free_bufs.front();
+                free_bufs.pop_front();
+            }
+
+            const size_t n = std::min(chunk, len - off);
+            spi_.transfer({}, std::span<uint8_t>(pool.data() + b * chunk, n));
+
+            {
+                std::lock_guard lk(m);
+                filled.push_back({b, uint32_t(addr + off), n});
+            }
+
+            cv.notify_all();
+        }
+    } catch (...) {
+
+        std::lock_guard lk(m);
+
+        if (!err) {
+
+            err = std::current_exception();
+        }
+    }
+
+    {
+        std::lock_guard lk(m);
+        done = true;
+    }
+
+    cv.notify_all();
+    consumer.join();
+
+    if (err) {
+
+        std::rethrow_exception(err);
+    }
+}
+
+template<SpiBackend SpiT>
+void BasicMR25H40<SpiT>::write(uint32_t addr, std::span<const uint8_t> in) {
+
+    unwrap(try_write(addr, in));
+}
+
+template<SpiBackend SpiT>
+size_t BasicMR25H40<SpiT>::fill(uint32_t addr, size_t len, uint8_t pattern) {
+
+    return unwrap(try_fill(addr, len, pattern));
+}
+
+template<SpiBackend SpiT>
+size_t BasicMR25H40<SpiT>::erase_all(uint8_t pattern) {
+
+    return fill(0, kSize, pattern);
+}
+
+#endif
+
+template<SpiBackend SpiT>
+uint8_t BasicMR25H40<SpiT>::read_status() {
+
+    uint8_t cmd = RDSR, sr = 0; CsGuardT cs(spi_);
+    spi_.transfer(std::span{&cmd,1}, {});
+    spi_.transfer({}, std::span{&sr,1});
+    return sr;
+}
+
+template<SpiBackend SpiT>
+void BasicMR25H40<SpiT>::write_status(uint8_t sr) {
+
+    write_enable();
+    uint8_t tx[2] = {WRSR, sr}; CsGuardT cs(spi_);
+    spi_.transfer(tx, {});
+}
+
+template<SpiBackend SpiT>
+void BasicMR25H40<SpiT>::write_enable() { 
+
+    uint8_t c = WREN; 
+    CsGuardT cs(spi_); 
+    spi_.transfer(std::span{&c,1}, {}); 
+}
+
+template<SpiBackend SpiT>
+void BasicMR25H40<SpiT>::write_disable() { 
+    
+    uint8_t c = WRDI; 
+    CsGuardT cs(spi_); 
+    spi_.transfer(std::span{&c,1}, {}); 
+}
+
+template<SpiBackend SpiT>
+void BasicMR25H40<SpiT>::sleep() { 
+    
+    uint8_t c = SLP; 
+    
+    { 
+        CsGuardT cs(spi_); 
+        spi_.transfer(std::span{&c,1}, {});
+    } 
+    
+    spi_.delay_us(3); }
+
+template<SpiBackend SpiT>
+void BasicMR25H40<SpiT>::wake() {  
+    
+    uint8_t c=WAK; 
+    
+    { 
+        CsGuardT cs(spi_); 
+        spi_.transfer(std::span{&c,1}, {});
+    } 
+    
+    spi_.delay_us(400); 
+}
+
+template<SpiBackend SpiT>
+void BasicMR25H40<SpiT>::set_block_protect(Protect p, bool hw_lock) {
+
+    uint8_t sr = read_status() & ~(0x0E);
+
+    if (p == Protect::UpperQuarter) {
+        
+        sr |= 1 << 2;
+    } else if (p == Protect::UpperHalf) {
+        
+        sr |= 1 << 3;
+    } else if (p == Protect::All) {
+        
+        sr |= (1 << 2) | (1 << 3);
+    }
+
+    if (hw_lock){ 
+        
+        spi_.set_wp(false); 
+        sr |= (1 << 7); 
+    }
+
+    write_status(sr);
+}
+
+// Virtual-Spi instantiation lives in mram_mr25h40.cpp
+extern template class BasicMR25H40<Spi>;
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+// Freestanding profile: no exceptions, no heap in the driver/store/codec.
+// Defaults to on when the compiler runs with -fno-exceptions.
+#ifndef MRAM_FREESTANDING
+#  if defined(__cpp_exceptions)
+#    define MRAM_FREESTANDING 0
+#  else
+#    define MRAM_FREESTANDING 1
+#  endif
+#endif
+
+#if !MRAM_FREESTANDING
+#include <stdexcept>
+#endif
+
+enum class MramErrc : uint8_t {
+    Ok = 0,
+    OutOfRange,
+    BadArgument,
+    NoRecord,
+    BadHeader,
+    CrcMismatch,
+    Overflow,
+};
+
+constexpr const char* to_string(MramErrc e) {
+
+    switch(e) {
+        case MramErrc::Ok:          return "ok";
+        case MramErrc::OutOfRange:  return "MR25H40: range";
+        case MramErrc::BadArgument: return "bad argument";
+        case MramErrc::NoRecord:    return "no record";
+        case MramErrc::BadHeader:   return "bad header";
+        case MramErrc::CrcMismatch: return "CRC mismatch";
+        case MramErrc::Overflow:    return "overflow";
+    }
+
+    return "unknown";
+}
+
+// Outcome of checking one on-device slot or block without decoding it
+enum class SlotState : uint8_t { Empty, Valid, Corrupt };
+
+struct Unexpected {
+    MramErrc error;
+};
+
+// std::expected-style result: a value or an error code
+template<class T>
+class [[nodiscard]] Result {
+
+public:
+    Result(const T& v) : val_(v) {}
+    Result(Unexpected u) : err_(u.error) {}
+
+    bool has_value() const { return err_ == MramErrc::Ok; }
+    explicit operator bool() const { return has_value(); }
+    MramErrc error() const { return err_; }
+
+    const T& value() const { return val_; }
+    const T& operator*() const { return val_; }
+    const T* operator->() const { return &val_; }
+
+private:
+    T val_{};
+    MramErrc err_ = MramErrc::Ok;
+
+};//class_result
+
+template<>
+class [[nodiscard]] Result<void> {
+
+public:
+    Result() = default;
+    Result(Unexpected u) : err_(u.error) {}
+
+    bool has_value() const { return err_ == MramErrc::Ok; }
+    explicit operator bool() const { return has_value(); }
+    MramErrc error() const { return err_; }
+
+private:
+    MramErrc err_ = MramErrc::Ok;
+
+};//class_result_void
+
+#if !MRAM_FREESTANDING
+
+// Hosted API bridge: error codes back to the exception types callers expect
+[[noreturn]] inline void throw_error(MramErrc e) {
+
+    switch(e) {
+        case MramErrc::OutOfRange:  throw std::out_of_range(to_string(e));
+        case MramErrc::BadArgument: throw std::invalid_argument(to_string(e));
+        case MramErrc::Overflow:    throw std::overflow_error(to_string(e));
+        default:                    throw std::runtime_error(to_string(e));
+    }
+}
+
+inline void unwrap(const Result<void>& r) {
+
+    if(!r) {
+
+        throw_error(r.error());
+    }
+}
+
+template<class T>
+T unwrap(const Result<T>& r) {
+
+    if(!r) {
+
+        throw_error(r.error());
+    }
+
+    return r.value();
+}
+
+#endif
@@ -0,0 +1,585 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <span>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <concepts>
+#include <new>
+
+#include "mram_mr25h40.h"
+#include "mram_heap.h"
+#include "bureau_codec.h"
+#include "bureau_store.h"
+#include "crc32.h"
+
+// Encoding of one RecordStore value type: at most kMaxSize bytes, kTag
+// tells the types sharing a heap apart. encode() writes into `out` (kMaxSize
+// bytes) and returns the length used, or Overflow when the value does not
+// fit; it never writes past `out`.
+template<class C, class T>
+concept RecordCodec = requires(const T& v, std::span<uint8_t> out, std::span<const uint8_t> in) {
+    { C::kTag } -> std::convertible_to<uint16_t>;
+    { C::kMaxSize } -> std::convertible_to<size_t>;
+    { C::encode(v, out) } -> std::same_as<Result<size_t>>;
+    { C::decode(in) } -> std::same_as<Result<T>>;
+};
+
+struct BureauRecordCodec {
+
+    static constexpr uint16_t kTag = 1;
+    static constexpr size_t kMaxSize = BureauCodec::kSize;
+
+    static Result<size_t> encode(const Bureau& b, std::span<uint8_t> out) {
+
+        if(out.size() < BureauCodec::kSize) {
+
+            return Unexpected{MramErrc::Overflow};
+        }
+
+        BureauCodec::encode(b,out.first<BureauCodec::kSize>());
+        return BureauCodec::kSize;
+    }
+
+    static Result<Bureau> decode(std::span<const uint8_t> in) {
+
+        if(in.size() != BureauCodec::kSize) {
+
+            return Unexpected{MramErrc::BadHeader};
+        }
+
+        return BureauCodec::try_decode(in.first<BureauCodec::kSize>());
+    }
+
+};//struct_bureau_record_codec
+
+// Records of one type, each in its own MramHeap block:
+//
+//   RecordStore<Bureau,BureauRecordCodec> rs(mram, heap);
+//   auto id = rs.create(b); rs.update(id, b2); rs.read(id); rs.erase(id);
+//
+// A block holds two slots. A slot is a RecordHeader (magic RECS, the codec
+// tag in `reserved`, payload length, seqno, CRC over the whole slot record
+// but the CRC field), the encoded payload and a commit word equal to the
+// seqno, the last bytes written. update() writes the older slot with one
+// WRITE, so a power cut leaves the previous value readable. Slots sit at 0
+// and half the block size of the heap class. Blocks come from heap pages
+// owned by the codec tag, so mount only looks at this store's blocks, never
+// at raw allocations or other record types of the same class. Blocks are
+// handed out zeroed: a torn create() leaves slot B blank and slot A cut
+// before its commit word, and the next mount gives that block back to the
+// heap. erase() clears the older slot header, then the newest, before the
+// heap zeroes the block: a cut leaves the newest value or no valid header,
+// never the older value, and mount gives a block cut that way back too. Any
+// other block without a valid slot is reported by corrupt() and kept until
+// erase(). The newest slot and seqno per record are cached in RAM; mount
+// reads each of this store's blocks once.
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+class BasicRecordStore {
+
+public:
+    using Id = uint32_t;
+    using Heap = BasicMramHeap<SpiT>;
+
+    static constexpr uint32_t kSlotSize = uint32_t(sizeof(RecordHeader) + Codec::kMaxSize + sizeof(uint64_t));
+    static constexpr size_t kClass = Heap::size_class(2 * kSlotSize);
+    static_assert(kClass < Heap::kClasses.size(),"RecordStore: record larger than the biggest heap class");
+    static constexpr uint32_t kBlockSize = Heap::kClasses[kClass];
+    static constexpr uint32_t kSlotStride = kBlockSize / 2;
+    static_assert(Codec::kTag != Heap::kNoOwner,"RecordStore: tag 0 marks raw heap blocks");
+
+    // No device access until try_mount()
+    BasicRecordStore(BasicMR25H40<SpiT>& mram, Heap& heap, std::nothrow_t);
+    Result<void> try_mount();
+
+    // BadArgument for an unknown id, CrcMismatch when neither slot reads
+    Result<Id> try_create(const T& v);
+    Result<void> try_update(Id id, const T& v);
+    Result<T> try_read(Id id);
+    // Clears both slot headers, newest last, then gives the block back to
+    // the heap; the record is gone once its newest header is. Also takes the
+    // blocks listed by corrupt()
+    Result<void> try_erase(Id id);
+
+#if !MRAM_FREESTANDING
+    // Mounts the store over the blocks `heap` holds for Codec::kTag
+    BasicRecordStore(BasicMR25H40<SpiT>& mram, Heap& heap);
+
+    Id create(const T& v);
+    void update(Id id, const T& v);
+    T read(Id id);
+    void erase(Id id);
+    uint64_t seqno(Id id) const;
+#endif
+
+    bool contains(Id id) const { return meta_.count(id) != 0; }
+    size_t size() const { return meta_.size(); }
+    std::vector<Id> ids() const;
+    // Torn creates and cut erases freed by the last mount
+    size_t reclaimed() const { return reclaimed_; }
+    // Blocks of this store the last mount found without a readable record,
+    // left allocated for inspection
+    const std::vector<Id>& corrupt() const { return corrupt_; }
+
+    static SlotState check_slot(std::span<const uint8_t> raw);
+
+private:
+    BasicMR25H40<SpiT>& mram_;
+    Heap& heap_;
+    static constexpr uint32_t MAGIC = 0x53434552; //=RECS
+    static constexpr uint16_t VERSION = 2;
+
+    struct Meta { uint64_t seqno; uint8_t slot; };
+    std::map<Id,Meta> meta_;
+    std::vector<Id> corrupt_;
+    size_t reclaimed_ = 0;
+
+    static bool torn_create(std::span<const uint8_t> block);
+    static bool erased(std::span<const uint8_t> block);
+    Result<void> clear_header(Id id, uint8_t slot);
+    const Meta* find(Id id) const;
+    using Slot = std::array<uint8_t,kSlotSize>;
+    static Result<size_t> build(Slot& rec, uint64_t seqno, const T& v);
+    static uint32_t record_crc(std::span<const uint8_t> rec);
+
+};//class_record_store
+
+template<class T, RecordCodec<T> Codec>
+using RecordStore = BasicRecordStore<T,Codec,Spi>;
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+BasicRecordStore<T,Codec,SpiT>::BasicRecordStore(BasicMR25H40<SpiT>& mram, Heap& heap, std::nothrow_t) : mram_(mram), heap_(heap) {}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+Result<void> BasicRecordStore<T,Codec,SpiT>::try_mount() {
+
+    meta_.clear();
+    corrupt_.clear();
+    reclaimed_ = 0;
+
+    std::vector<Id> orphans;
+    std::array<uint8_t,kBlockSize> raw{};
+    Result<void> err{};
+
+    heap_.for_each_allocated([&](uint32_t addr, uint32_t bs) {
+
+        if(!err || bs != kBlockSize || heap_.try_owner(addr).value() != Codec::kTag) {
+
+            return;
+        }
+
+        err = mram_.try_read(addr,raw);
+
+        if(!err) {
+
+            return;
+        }
+
+        bool any = false, foreign = false;
+        Meta best{0,0};
+
+        for(uint8_t s = 0; s < 2; ++s) {
+
+            const auto slot = std::span<const uint8_t>(raw).subspan(s * kSlotStride,kSlotStride);
+
+            if(check_slot(slot) != SlotState::Valid) {
+
+                continue;
+            }
+
+            RecordHeader h{};
+            std::memcpy(&h,slot.data(),sizeof(h));
+
+            if(h.reserved != Codec::kTag) {
+
+                foreign = true;
+                continue;
+            }
+
+            if(!any || h.seqno > best.seqno) {
+
+                best = Meta{h.seqno,s};
+            }
+
+            any = true;
+        }
+
+        if(any) {
+
+            meta_[addr] = best;
+        } else if(!foreign && (torn_create(raw) || erased(raw))) {
+
+            orphans.push_back(addr);
+        } else {
+
+            corrupt_.push_back(addr);
+        }
+    });
+
+    if(!err) {
+
+        return err;
+    }
+
+    for(Id id : orphans) {
+
+        if(auto r = heap_.try_free(id); !r) {
+
+            return r;
+        }
+
+        reclaimed_++;
+    }
+
+    return {};
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+Result<typename BasicRecordStore<T,Codec,SpiT>::Id> BasicRecordStore<T,Codec,SpiT>::try_create(const T& v) {
+
+    // Encoded before the alloc: a value that does not fit takes no block.
+    // The block is zero, so slot B stays empty and one WRITE commits slot A
+    Slot rec{};
+    const Result<size_t> n = build(rec,1,v);
+
+    if(!n) {
+
+        return Unexpected{n.error()};
+    }
+
+    const Result<uint32_t> id = heap_.try_alloc(kBlockSize,Codec::kTag);
+
+    if(!id) {
+
+        return Unexpected{id.error()};
+    }
+
+    // A failed WRITE leaves a block mount treats as a torn create
+    if(auto r = mram_.try_write(*id,std::span<const uint8_t>(rec).first(*n)); !r) {
+
+        return Unexpected{r.error()};
+    }
+
+    meta_[*id] = Meta{1,0};
+
+    return *id;
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+Result<void> BasicRecordStore<T,Codec,SpiT>::try_update(Id id, const T& v) {
+
+    const Meta* m = find(id);
+
+    if(m == nullptr) {
+
+        return Unexpected{MramErrc::BadArgument};
+    }
+
+    const auto slot = uint8_t(m->slot ^ 1);
+    const uint64_t seqno = m->seqno + 1;
+    Slot rec{};
+    const Result<size_t> n = build(rec,seqno,v);
+
+    if(!n) {
+
+        return Unexpected{n.error()};
+    }
+
+    if(auto r = mram_.try_write(id + slot * kSlotStride,std::span<const uint8_t>(rec).first(*n)); !r) {
+
+        return r;
+    }
+
+    meta_[id] = Meta{seqno,slot};
+
+    return {};
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+Result<T> BasicRecordStore<T,Codec,SpiT>::try_read(Id id) {
+
+    const Meta* m = find(id);
+
+    if(m == nullptr) {
+
+        return Unexpected{MramErrc::BadArgument};
+    }
+
+    Slot raw{};
+    RecordHeader h{};
+
+    // Newest slot first; the other one still holds the previous value
+    for(uint8_t s : {m->slot, uint8_t(m->slot ^ 1)}) {
+
+        if(auto r = mram_.try_read(id + s * kSlotStride,raw); !r) {
+
+            return Unexpected{r.error()};
+        }
+
+        std::memcpy(&h,raw.data(),sizeof(h));
+
+        if(check_slot(raw) == SlotState::Valid && h.reserved == Codec::kTag) {
+
+            return Codec::decode(std::span<const uint8_t>(raw).subspan(sizeof(RecordHeader),h.length));
+        }
+    }
+
+    return Unexpected{MramErrc::CrcMismatch};
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+Result<void> BasicRecordStore<T,Codec,SpiT>::try_erase(Id id) {
+
+    uint8_t newest = 1;
+    auto bad = std::find(corrupt_.begin(),corrupt_.end(),id);
+
+    if(bad == corrupt_.end()) {
+
+        const Meta* m = find(id);
+
+        if(m == nullptr) {
+
+            return Unexpected{MramErrc::BadArgument};
+        }
+
+        newest = m->slot;
+    }
+
+    // Older slot first: until the newest header goes the record reads as before
+    if(auto r = clear_header(id,uint8_t(newest ^ 1)); !r) {
+
+        return r;
+    }
+
+    if(auto r = clear_header(id,newest); !r) {
+
+        return r;
+    }
+
+    if(auto r = heap_.try_free(id); !r) {
+
+        return r;
+    }
+
+    if(bad != corrupt_.end()) {
+
+        corrupt_.erase(bad);
+    } else {
+
+        meta_.erase(id);
+    }
+
+    return {};
+}
+
+#if !MRAM_FREESTANDING
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+BasicRecordStore<T,Codec,SpiT>::BasicRecordStore(BasicMR25H40<SpiT>& mram, Heap& heap)
+    : BasicRecordStore(mram,heap,std::nothrow) {
+
+    unwrap(try_mount());
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+typename BasicRecordStore<T,Codec,SpiT>::Id BasicRecordStore<T,Codec,SpiT>::create(const T& v) {
+
+    return unwrap(try_create(v));
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+void BasicRecordStore<T,Codec,SpiT>::update(Id id, const T& v) {
+
+    unwrap(try_update(id,v));
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+T BasicRecordStore<T,Codec,SpiT>::read(Id id) {
+
+    return unwrap(try_read(id));
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+void BasicRecordStore<T,Codec,SpiT>::erase(Id id) {
+
+    unwrap(try_erase(id));
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+uint64_t BasicRecordStore<T,Codec,SpiT>::seqno(Id id) const {
+
+    const Meta* m = find(id);
+
+    if(m == nullptr) {
+
+        throw_error(MramErrc::BadArgument);
+    }
+
+    return m->seqno;
+}
+
+#endif
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+std::vector<typename BasicRecordStore<T,Codec,SpiT>::Id> BasicRecordStore<T,Codec,SpiT>::ids() const {
+
+    std::vector<Id> out;
+    out.reserve(meta_.size());
+
+    for(const auto& [id, m] : meta_) {
+
+        out.push_back(id);
+    }
+
+    return out;
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+bool BasicRecordStore<T,Codec,SpiT>::torn_create(std::span<const uint8_t> block) {
+
+    // Only update() writes slot B: still blank
+    const auto b = block.subspan(kSlotStride,kSlotStride);
+
+    if(!std::all_of(b.begin(),b.end(),[](uint8_t v) { return v == 0; })) {
+
+        return false;
+    }
+
+    // Slot A cut short: a prefix of a seqno 1 record over zeros. Its commit
+    // word, the last bytes written, is still zero (any byte of it landing
+    // makes the record valid), and so is the slot past the record. Anything
+    // else, a record failing its CRC or a length no prefix of a record could
+    // hold, is damage
+    RecordHeader h{};
+    std::memcpy(&h,block.data(),sizeof(h));
+
+    if(h.seqno > 1 || h.length > kSlotStride - sizeof(RecordHeader) - sizeof(uint64_t)) {
+
+        return false;
+    }
+
+    const auto tail = block.subspan(sizeof(RecordHeader) + h.length,kSlotStride - sizeof(RecordHeader) - h.length);
+
+    return std::all_of(tail.begin(),tail.end(),[](uint8_t v) { return v == 0; });
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+bool BasicRecordStore<T,Codec,SpiT>::erased(std::span<const uint8_t> block) {
+
+    // erase() cut after the older header was cleared: the newest one has at
+    // least the first byte of its magic cleared, the rest of the magic as
+    // written. A bit flip or a torn create does not look like that
+    const auto zero = [](std::span<const uint8_t> h) { return std::all_of(h.begin(),h.end(),[](uint8_t v) { return v == 0; }); };
+    const auto clearing = [](std::span<const uint8_t> h) {
+
+        std::array<uint8_t,sizeof(MAGIC)> magic{};
+        std::memcpy(magic.data(),&MAGIC,sizeof(MAGIC));
+        size_t k = 0;
+
+        while(k < magic.size() && h[k] == 0) {
+
+            ++k;
+        }
+
+        return k > 0 && std::equal(magic.begin() + k,magic.end(),h.begin() + k);
+    };
+
+    const auto a = block.first(sizeof(RecordHeader));
+    const auto b = block.subspan(kSlotStride,sizeof(RecordHeader));
+
+    return (zero(a) && clearing(b)) || (zero(b) && clearing(a));
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+Result<void> BasicRecordStore<T,Codec,SpiT>::clear_header(Id id, uint8_t slot) {
+
+    const std::array<uint8_t,sizeof(RecordHeader)> zero{};
+
+    return mram_.try_write(id + slot * kSlotStride,zero);
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+const typename BasicRecordStore<T,Codec,SpiT>::Meta* BasicRecordStore<T,Codec,SpiT>::find(Id id) const {
+
+    auto it = meta_.find(id);
+
+    return it == meta_.end() ? nullptr : &it->second;
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+Result<size_t> BasicRecordStore<T,Codec,SpiT>::build(Slot& rec, uint64_t seqno, const T& v) {
+
+    // Whole record built in RAM, committed by one WRITE of the returned length
+    const Result<size_t> enc = Codec::encode(v,std::span<uint8_t>(rec).subspan(sizeof(RecordHeader),Codec::kMaxSize));
+
+    if(!enc) {
+
+        return Unexpected{enc.error()};
+    }
+
+    // A length past the span means the codec broke its contract: no record
+    if(enc.value() > Codec::kMaxSize) {
+
+        return Unexpected{MramErrc::Overflow};
+    }
+
+    const size_t len = enc.value();
+
+    const size_t commit_off = sizeof(RecordHeader) + len;
+    std::memcpy(rec.data() + commit_off,&seqno,sizeof(seqno));
+
+    RecordHeader h{MAGIC,VERSION,uint16_t(Codec::kTag),uint32_t(len),0,seqno};
+    std::memcpy(rec.data(),&h,sizeof(h));
+    h.crc32 = record_crc(std::span<const uint8_t>(rec).first(commit_off + sizeof(seqno)));
+    std::memcpy(rec.data(),&h,sizeof(h));
+
+    return commit_off + sizeof(seqno);
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+uint32_t BasicRecordStore<T,Codec,SpiT>::record_crc(std::span<const uint8_t> rec) {
+
+    constexpr size_t crc_off = offsetof(RecordHeader,crc32);
+    const uint32_t c = Crc32::update(~0u,rec.first(crc_off));
+
+    return Crc32::update(c,rec.subspan(crc_off + sizeof(uint32_t))) ^ ~0u;
+}
+
+template<class T, RecordCodec<T> Codec, SpiBackend SpiT>
+SlotState BasicRecordStore<T,Codec,SpiT>::check_slot(std::span<const uint8_t> raw) {
+
+    RecordHeader h{};
+
+    if(raw.size() < sizeof(RecordHeader)) {
+
+        return SlotState::Corrupt;
+    }
+
+    std::memcpy(&h,raw.data(),sizeof(h));
+
+    if(h.magic != MAGIC) {
+
+        return SlotState::Empty;
+    }
+
+    // Length bounded by the slot, not by this codec: other types share the class
+    if(h.version != VERSION || h.length > raw.size() - sizeof(RecordHeader) - sizeof(uint64_t)) {
+
+        return SlotState::Corrupt;
+    }
+
+    const size_t commit_off = sizeof(RecordHeader) + h.length;
+    uint64_t commit = 0;
+    std::memcpy(&commit,raw.data() + commit_off,sizeof(commit));
+
+    if(commit != h.seqno || record_crc(raw.first(commit_off + sizeof(commit))) != h.crc32) {
+
+        return SlotState::Corrupt;
+    }
+
+    return SlotState::Valid;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <unordered_map>
+
+#include "mram_mr25h40.h"
+#include "bus_gate.h"
+#include "bureau_history.h"
+
+// A run of equally sized slots and how to check one of them
+struct ScrubTarget {
+    const char* name;
+    uint32_t base;
+    uint32_t slot_size;
+    uint32_t slots;
+    std::function<SlotState(std::span<const uint8_t>)> check;
+};
+
+namespace ScrubTargets {
+
+    ScrubTarget store_records();
+    ScrubTarget history(uint32_t base = BureauHistory::kDefaultBase, uint32_t size = BureauHistory::kDefaultSize);
+
+}//ns_scrub_targets
+
+struct ScrubConfig {
+    uint32_t bytes_per_sec = 64 * 1024;                // 0 = unthrottled
+    uint32_t chunk = 512;                              // max bytes per READ
+    std::chrono::milliseconds pass_interval{1000};     // pause between passes
+    BusPriority priority = BusPriority::Background;
+};
+
+// Background integrity checker. Walks the targets in small READs through
+// its own GatedSpi, paced to the byte budget. A slot is reported once it
+// fails its check with the same bytes on two consecutive passes; a single
+// failure may be a foreground write in flight.
+class Scrubber {
+
+public:
+    using CorruptCallback = std::function<void(const ScrubTarget& t, uint32_t slot, uint32_t addr)>;
+
+    Scrubber(Spi& bus, BusGate& gate, std::vector<ScrubTarget> targets, ScrubConfig cfg = {}, CorruptCallback on_corrupt = {});
+    ~Scrubber();
+
+    void start();
+    void stop();
+    // One synchronous pass over all targets; false if stopped midway
+    bool run_pass();
+
+    uint64_t passes() const { return passes_; }
+    uint64_t slots_checked() const { return slots_; }
+    uint64_t corrupt_found() const { return corrupt_; }
+    uint64_t bytes_read() const { return bytes_; }
+
+private:
+    GatedSpi spi_;
+    MR25H40 mram_;
+    std::vector<ScrubTarget> targets_;
+    ScrubConfig cfg_;
+    CorruptCallback on_corrupt_;
+
+    std::atomic<uint64_t> passes_{0}, slots_{0}, corrupt_{0}, bytes_{0};
+    bool stop_ = false;
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::thread thread_;
+    std::chrono::steady_clock::time_point due_{};
+    std::unordered_map<uint32_t,uint32_t> suspects_;   // addr -> CRC of bad bytes seen last pass
+    std::unordered_map<uint32_t,uint32_t> reported_;
+
+    bool pace(size_t bytes);
+    bool sleep_until(std::chrono::steady_clock::time_point t);
+
+};//class_scrubber
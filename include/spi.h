@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <span>
+#include <concepts>
 
 // Абстрактный SPI интерфейс
 struct Spi {
@@ -16,11 +17,27 @@ struct Spi {
 
 };//class_abstract_spi
 
+// Требования к конкретному SPI бэкенду для шаблонного драйвера;
+// Spi (виртуальный интерфейс) — один из вариантов
+template<class S>
+concept SpiBackend = requires(S& s, std::span<const uint8_t> tx, std::span<uint8_t> rx, uint32_t us, bool level) {
+    s.transfer(tx, rx);
+    s.cs_assert();
+    s.cs_deassert();
+    s.delay_us(us);
+    s.set_wp(level);
+};
+
+static_assert(SpiBackend<Spi>);
+
 // RAII-обертка для CS
-struct CsGuard {
+template<SpiBackend S>
+struct BasicCsGuard {
 
-    Spi& s;
-    explicit CsGuard(Spi& s_) : s(s_) { s.cs_assert(); }
-    ~CsGuard() { s.cs_deassert(); }
+    S& s;
+    explicit BasicCsGuard(S& s_) : s(s_) { s.cs_assert(); }
+    ~BasicCsGuard() { s.cs_deassert(); }
 
 };//class_cs_protection_wrapper
+
+using CsGuard = BasicCsGuard<Spi>;
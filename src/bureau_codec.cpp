@@ -5,7 +5,6 @@
 #include <span>
 #include <cstring>
 #include <limits>
-#include <stdexcept>
 
 namespace {
 
@@ -69,6 +68,7 @@ namespace {
 
 void BureauCodec::encode(const Bureau& b, std::span<uint8_t, kSize> out) {
 
+#if !MRAM_FREESTANDING
     if constexpr(sizeof(size_t) < 8) {
         
         if(b.prog_qty > std::numeric_limits<uint64_t>::max()) {
@@ -76,6 +76,7 @@ void BureauCodec::encode(const Bureau& b, std::span<uint8_t, kSize> out) {
             throw std::overflow_error("too big");
         } 
     }
+#endif
 
     put_u64(out.subspan<0,8>(), static_cast<uint64_t>(b.prog_qty));
     put_u32(out.subspan<8,4>(), b.math_qty);
@@ -84,7 +85,7 @@ void BureauCodec::encode(const Bureau& b, std::span<uint8_t, kSize> out) {
     put_f32(out.subspan<16,4>(), b.salary_sum);
 }
 
-Bureau BureauCodec::decode(std::span<const uint8_t, kSize> in){
+Result<Bureau> BureauCodec::try_decode(std::span<const uint8_t, kSize> in){
 
     Bureau b{};
     uint64_t pq = get_u64(in.subspan<0,8>());
@@ -93,7 +94,7 @@ Bureau BureauCodec::decode(std::span<const uint8_t, kSize> in){
         
         if(pq>std::numeric_limits<size_t>::max()) {
             
-            throw std::overflow_error("overflow"); 
+            return Unexpected{MramErrc::Overflow};
         }
     }
 
@@ -104,3 +105,12 @@ Bureau BureauCodec::decode(std::span<const uint8_t, kSize> in){
     
     return b;
 }
+
+#if !MRAM_FREESTANDING
+
+Bureau BureauCodec::decode(std::span<const uint8_t, kSize> in){
+
+    return unwrap(try_decode(in));
+}
+
+#endif
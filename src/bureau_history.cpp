@@ -0,0 +1,565 @@
+#include "../include/bureau_history.h"
+#include "../include/crc32.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+    inline uint64_t zigzag(int64_t v) {
+
+        return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t u) {
+
+        return int64_t((u >> 1) ^ (~(u & 1) + 1));
+    }
+
+    inline size_t put_varint(uint64_t v, uint8_t* out) {
+
+        size_t n = 0;
+
+        while(v >= 0x80) {
+
+            out[n++] = uint8_t(v) | 0x80;
+            v >>= 7;
+        }
+
+        out[n++] = uint8_t(v);
+
+        return n;
+    }
+
+    inline uint64_t get_varint(std::span<const uint8_t> in, size_t& pos) {
+
+        uint64_t v = 0;
+
+        for(int shift = 0; shift < 64; shift += 7) {
+
+            if(pos >= in.size()) {
+
+                throw std::runtime_error("truncated varint");
+            }
+
+            uint8_t b = in[pos++];
+            v |= uint64_t(b & 0x7F) << shift;
+
+            if(!(b & 0x80)) {
+
+                return v;
+            }
+        }
+
+        throw std::runtime_error("bad varint");
+    }
+
+    inline uint32_t f32_bits(float f) {
+
+        uint32_t v;
+        std::memcpy(&v,&f,4);
+        return v;
+    }
+
+    inline float bits_f32(uint32_t v) {
+
+        float f;
+        std::memcpy(&f,&v,4);
+        return f;
+    }
+
+    // Commit byte after each delta: never 0, so a delta whose WRITE was cut
+    // before its last byte reads as absent in the zeroed body
+    inline uint8_t delta_check(uint64_t seqno, std::span<const uint8_t> delta) {
+
+        uint8_t sb[sizeof(seqno)];
+        std::memcpy(sb,&seqno,sizeof(seqno));
+        const uint32_t c = Crc32::update(Crc32::update(~0u,sb),delta) ^ ~0u;
+
+        return uint8_t(1 + c % 255);
+    }
+
+    // Keyframe and committed deltas of a block body: f(seqno, b) for each while
+    // f returns true. Returns the body bytes walked.
+    template<class F>
+    uint32_t walk_block(uint64_t first_seqno, std::span<const uint8_t> body, F&& f) {
+
+        Bureau b = BureauCodec::decode(body.first<BureauCodec::kSize>());
+        size_t pos = BureauCodec::kSize;
+        uint64_t seq = first_seqno;
+
+        if(!f(seq,b)) {
+
+            return uint32_t(pos);
+        }
+
+        while(pos < body.size()) {
+
+            Bureau next = b;
+            size_t end = pos;
+
+            try {
+
+                HistoryCodec::decode_delta(body,end,next);
+            } catch(const std::runtime_error&) {
+
+                break;
+            }
+
+            if(end >= body.size() || body[end] != delta_check(seq + 1,body.subspan(pos,end - pos))) {
+
+                break;
+            }
+
+            pos = end + 1;
+            b = next;
+
+            if(!f(++seq,b)) {
+
+                break;
+            }
+        }
+
+        return uint32_t(pos);
+    }
+
+    // Snapshot `seqno` of a block, if the block holds it
+    std::optional<Bureau> block_at(uint64_t first_seqno, std::span<const uint8_t> body, uint64_t seqno) {
+
+        std::optional<Bureau> out;
+
+        walk_block(first_seqno,body,[&](uint64_t s, const Bureau& b) {
+
+            if(s == seqno) {
+
+                out = b;
+            }
+
+            return s < seqno;
+        });
+
+        return out;
+    }
+
+}
+
+size_t HistoryCodec::encode_delta(const Bureau& prev, const Bureau& cur, std::span<uint8_t, kMaxDelta> out) {
+
+    const int64_t dp = int64_t(uint64_t(cur.prog_qty) - uint64_t(prev.prog_qty));
+    const int64_t dm = int64_t(cur.math_qty) - int64_t(prev.math_qty);
+    const int64_t dh = int64_t(cur.head_qty) - int64_t(prev.head_qty);
+    const int64_t ds = int32_t(f32_bits(cur.salary_sum) - f32_bits(prev.salary_sum));
+
+    size_t n = put_varint(zigzag(dp), out.data());
+    n += put_varint(zigzag(dm), out.data() + n);
+    n += put_varint(zigzag(dh), out.data() + n);
+    n += put_varint(zigzag(ds), out.data() + n);
+
+    return n;
+}
+
+void HistoryCodec::decode_delta(std::span<const uint8_t> in, size_t& pos, Bureau& b) {
+
+    b.prog_qty = size_t(uint64_t(b.prog_qty) + uint64_t(unzigzag(get_varint(in,pos))));
+    b.math_qty = uint32_t(int64_t(b.math_qty) + unzigzag(get_varint(in,pos)));
+    b.head_qty = uint8_t(int64_t(b.head_qty) + unzigzag(get_varint(in,pos)));
+    b.salary_sum = bits_f32(f32_bits(b.salary_sum) + uint32_t(unzigzag(get_varint(in,pos))));
+}
+
+BureauHistory::BureauHistory(MR25H40& mram, uint32_t base, uint32_t size)
+    : mram_(mram), base_(base), nblocks_(size / kBlockSize) {
+
+    if(base > MR25H40::kSize || size > MR25H40::kSize - base || nblocks_ < 2) {
+
+        throw std::invalid_argument("BureauHistory: region");
+    }
+
+    mount();
+}
+
+uint64_t BureauHistory::first_seqno() const {
+
+    return empty() ? 0 : first_seq_[tail_];
+}
+
+uint64_t BureauHistory::last_seqno() const {
+
+    return empty() ? 0 : open_hdr_.first_seqno + open_hdr_.count - 1;
+}
+
+uint64_t BureauHistory::append(const Bureau& b) {
+
+    if(empty()) {
+
+        start_block(1,b);
+        return 1;
+    }
+
+    const uint64_t seq = last_seqno() + 1;
+    std::array<uint8_t,HistoryCodec::kMaxDelta + 1> entry{};
+    size_t n = HistoryCodec::encode_delta(last_,b,std::span<uint8_t,HistoryCodec::kMaxDelta>(entry.data(),HistoryCodec::kMaxDelta));
+    entry[n] = delta_check(seq,std::span<const uint8_t>(entry.data(),n));
+    n++;
+
+    if(open_hdr_.used + n > kBodySize || open_hdr_.count == UINT16_MAX) {
+
+        start_block(seq,b);
+        return seq;
+    }
+
+    // One WRITE per record, check byte last; the header is not touched
+    std::memcpy(open_body_.data() + open_hdr_.used,entry.data(),n);
+    mram_.write(block_addr(head()) + sizeof(HistoryBlockHeader) + open_hdr_.used,std::span<const uint8_t>(entry.data(),n));
+
+    open_hdr_.used += uint32_t(n);
+    open_hdr_.count++;
+    last_ = b;
+
+    return seq;
+}
+
+Bureau BureauHistory::at(uint64_t seqno) {
+
+    auto idx = find_block(seqno);
+
+    if(!idx) {
+
+        throw std::out_of_range("BureauHistory: seqno");
+    }
+
+    std::optional<Bureau> b;
+
+    if(*idx == head()) {
+
+        b = block_at(open_hdr_.first_seqno,std::span<const uint8_t>(open_body_.data(),open_hdr_.used),seqno);
+    } else {
+
+        HistoryBlockHeader h{};
+        std::array<uint8_t,kBodySize> body{};
+
+        if(!load_block(*idx,h,body)) {
+
+            throw std::runtime_error("CRC mismatch");
+        }
+
+        b = block_at(h.first_seqno,body,seqno);
+    }
+
+    if(!b) {
+
+        throw std::out_of_range("BureauHistory: seqno");
+    }
+
+    return *b;
+}
+
+void BureauHistory::scan(uint64_t from, uint64_t to, const ScanCallback& fn, uint32_t batch_blocks) {
+
+    if(empty()) {
+
+        return;
+    }
+
+    from = std::max(from,first_seqno());
+    to = std::min(to,last_seqno());
+
+    if(from > to) {
+
+        return;
+    }
+
+    batch_blocks = std::clamp<uint32_t>(batch_blocks,1,nblocks_);
+    std::vector<uint8_t> batch(size_t(batch_blocks) * kBlockSize);
+    const uint32_t first = *find_block(from);
+    uint32_t k = (first + nblocks_ - tail_) % nblocks_;  // logical position in the ring
+
+    while(k < live_) {
+
+        // One READ per run of physically adjacent blocks
+        const uint32_t phys = (tail_ + k) % nblocks_;
+        const uint32_t n = std::min({batch_blocks,live_ - k,nblocks_ - phys});
+        mram_.read(block_addr(phys),std::span<uint8_t>(batch.data(),size_t(n) * kBlockSize));
+
+        for(uint32_t j = 0; j < n; ++j) {
+
+            const uint8_t* raw = batch.data() + size_t(j) * kBlockSize;
+            HistoryBlockHeader h{};
+            std::memcpy(&h,raw,sizeof(HistoryBlockHeader));
+            std::span<const uint8_t> body(raw + sizeof(HistoryBlockHeader),kBodySize);
+
+            if(!valid_block(h,body)) {
+
+                throw std::runtime_error("CRC mismatch");
+            }
+
+            bool done = false;
+
+            walk_block(h.first_seqno,body,[&](uint64_t s, const Bureau& b) {
+
+                if(s > to) {
+
+                    done = true;
+                    return false;
+                }
+
+                if(s >= from) {
+
+                    fn(s,b);
+                }
+
+                return true;
+            });
+
+            if(done) {
+
+                return;
+            }
+        }
+
+        k += n;
+    }
+}
+
+void BureauHistory::mount() {
+
+    first_seq_.assign(nblocks_,0);
+    tail_ = 0;
+    live_ = 0;
+
+    for(uint32_t i = 0; i < nblocks_; ++i) {
+
+        std::array<uint8_t,sizeof(HistoryBlockHeader)> hb{};
+        mram_.read(block_addr(i),hb);
+        HistoryBlockHeader h{};
+        std::memcpy(&h,hb.data(),hb.size());
+
+        if(h.magic == MAGIC && h.version == VERSION && h.count > 0 &&
+           h.used >= BureauCodec::kSize && h.used <= kBodySize && h.first_seqno > 0) {
+
+            first_seq_[i] = h.first_seqno;
+        }
+    }
+
+    // The newest block is the open one; drop it if its header or keyframe
+    // was torn, else keep its deltas up to the last complete one
+    for(;;) {
+
+        auto it = std::max_element(first_seq_.begin(),first_seq_.end());
+
+        if(*it == 0) {
+
+            return;
+        }
+
+        const uint32_t hd = uint32_t(it - first_seq_.begin());
+
+        if(!load_block(hd,open_hdr_,open_body_) && !valid_keyframe(open_hdr_,open_body_)) {
+
+            first_seq_[hd] = 0;
+            continue;
+        }
+
+        uint16_t count = 0;
+        const uint32_t used = walk_block(open_hdr_.first_seqno,open_body_,[&](uint64_t, const Bureau& b) {
+
+            count++;
+            last_ = b;
+            return count < UINT16_MAX;
+        });
+
+        // Clear what a cut append left behind, so the next delta lands on zeros
+        if(std::any_of(open_body_.begin() + used,open_body_.end(),[](uint8_t v) { return v != 0; })) {
+
+            std::fill(open_body_.begin() + used,open_body_.end(),0);
+
+            // A short fill met the write-protected region: appends would land on junk
+            if(mram_.fill(block_addr(hd) + sizeof(HistoryBlockHeader) + used,kBodySize - used,0) != kBodySize - used) {
+
+                throw std::out_of_range("BureauHistory: block write-protected");
+            }
+        }
+
+        open_hdr_.count = count;
+        open_hdr_.used = used;
+
+        // Walk back while seqnos keep decreasing to find the oldest block
+        uint32_t k = hd;
+        live_ = 1;
+
+        while(live_ < nblocks_) {
+
+            const uint32_t prev = (k + nblocks_ - 1) % nblocks_;
+
+            if(first_seq_[prev] == 0 || first_seq_[prev] >= first_seq_[k]) {
+
+                break;
+            }
+
+            k = prev;
+            live_++;
+        }
+
+        tail_ = k;
+
+        return;
+    }
+}
+
+bool BureauHistory::load_block(uint32_t idx, HistoryBlockHeader& h, std::span<uint8_t, kBodySize> body) {
+
+    std::array<uint8_t,kBlockSize> raw{};
+    mram_.read(block_addr(idx),raw);
+    std::memcpy(&h,raw.data(),sizeof(HistoryBlockHeader));
+    std::memcpy(body.data(),raw.data() + sizeof(HistoryBlockHeader),kBodySize);
+
+    return valid_block(h,body);
+}
+
+SlotState BureauHistory::check_block(std::span<const uint8_t> raw) {
+
+    HistoryBlockHeader h{};
+
+    if(raw.size() < kBlockSize) {
+
+        return SlotState::Corrupt;
+    }
+
+    std::memcpy(&h,raw.data(),sizeof(HistoryBlockHeader));
+
+    if(h.magic != MAGIC) {
+
+        return SlotState::Empty;
+    }
+
+    return valid_block(h,raw.subspan(sizeof(HistoryBlockHeader),kBodySize)) ? SlotState::Valid : SlotState::Corrupt;
+}
+
+bool BureauHistory::valid_keyframe(const HistoryBlockHeader& h, std::span<const uint8_t> body) {
+
+    if(h.magic != MAGIC || h.version != VERSION || h.count != 1 ||
+       h.used != BureauCodec::kSize || body.size() != kBodySize) {
+
+        return false;
+    }
+
+    return Crc32::calc(body.first(h.used)) == h.crc32;
+}
+
+bool BureauHistory::valid_block(const HistoryBlockHeader& h, std::span<const uint8_t> body) {
+
+    if(!valid_keyframe(h,body)) {
+
+        return false;
+    }
+
+    // A corrupt delta ends the walk early and leaves non-zero bytes behind
+    const uint32_t used = walk_block(h.first_seqno,body,[](uint64_t, const Bureau&) { return true; });
+
+    return std::all_of(body.begin() + used,body.end(),[](uint8_t v) { return v == 0; });
+}
+
+void BureauHistory::start_block(uint64_t seqno, const Bureau& b) {
+
+    const uint32_t idx = empty() ? 0 : (head() + 1) % nblocks_;
+
+    // The previous lap is cleared first: deltas are only ever written onto
+    // zeros. A short fill met the write-protected region; nothing changes
+    if(mram_.fill(block_addr(idx),kBlockSize,0) != kBlockSize) {
+
+        throw std::out_of_range("BureauHistory: block write-protected");
+    }
+
+    if(live_ == nblocks_) {
+
+        first_seq_[tail_] = 0;
+        tail_ = (tail_ + 1) % nblocks_;
+        live_--;
+    }
+
+    if(empty()) {
+
+        tail_ = idx;
+    }
+
+    open_body_.fill(0);
+    BureauCodec::encode(b,std::span<uint8_t,BureauCodec::kSize>(open_body_.data(),BureauCodec::kSize));
+    open_hdr_ = HistoryBlockHeader{MAGIC,VERSION,1,uint32_t(BureauCodec::kSize),0,seqno};
+    open_hdr_.crc32 = Crc32::calc(std::span<const uint8_t>(open_body_.data(),BureauCodec::kSize));
+
+    // Header and keyframe are adjacent: one WRITE, a torn one fails the CRC
+    std::array<uint8_t,sizeof(HistoryBlockHeader) + BureauCodec::kSize> raw{};
+    std::memcpy(raw.data(),&open_hdr_,sizeof(HistoryBlockHeader));
+    std::memcpy(raw.data() + sizeof(HistoryBlockHeader),open_body_.data(),BureauCodec::kSize);
+    mram_.write(block_addr(idx),raw);
+
+    first_seq_[idx] = seqno;
+    live_++;
+    last_ = b;
+}
+
+std::optional<uint32_t> BureauHistory::find_block(uint64_t seqno) const {
+
+    if(empty() || seqno < first_seqno() || seqno > last_seqno()) {
+
+        return std::nullopt;
+    }
+
+    // Last live block whose keyframe seqno is <= seqno
+    uint32_t lo = 0, hi = live_;
+
+    while(hi - lo > 1) {
+
+        const uint32_t mid = lo + (hi - lo) / 2;
+
+        if(first_seq_[(tail_ + mid) % nblocks_] <= seqno) {
+
+            lo = mid;
+        } else {
+
+            hi = mid;
+        }
+    }
+
+    return (tail_ + lo) % nblocks_;
+}
+
+HistoryQuery::Aggregate HistoryQuery::aggregate(BureauHistory& h, uint64_t from, uint64_t to) {
+
+    Aggregate a{};
+
+    h.scan(from,to,[&](uint64_t seqno, const Bureau& b) {
+
+        if(a.salary.count == 0) {
+
+            a.first_seqno = seqno;
+        }
+
+        a.last_seqno = seqno;
+
+        for(size_t f = 0; f < kFields; ++f) {
+
+            a.fields[f].add(value(b,Field(f)));
+        }
+
+        a.salary.add(b.salary_sum);
+    });
+
+    return a;
+}
+
+HistoryQuery::IntStats HistoryQuery::stats(BureauHistory& h, uint64_t from, uint64_t to, Field f) {
+
+    IntStats st{};
+    h.scan(from,to,[&](uint64_t, const Bureau& b) { st.add(value(b,f)); });
+
+    return st;
+}
+
+HistoryQuery::RealStats HistoryQuery::salary_stats(BureauHistory& h, uint64_t from, uint64_t to) {
+
+    RealStats st{};
+    h.scan(from,to,[&](uint64_t, const Bureau& b) { st.add(b.salary_sum); });
+
+    return st;
+}
@@ -0,0 +1,288 @@
+#include "../include/bureau_queue.h"
+#include "../include/crc32.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cstddef>
+#include <array>
+#include <algorithm>
+
+BureauQueue::BureauQueue(MR25H40& mram, uint32_t base, uint32_t capacity, uint32_t batch)
+    : BureauQueue(mram, mram, base, capacity, batch) {}
+
+BureauQueue::BureauQueue(MR25H40& producer, MR25H40& consumer, uint32_t base, uint32_t capacity, uint32_t batch)
+    : prod_(producer), cons_(consumer), base_(base), capacity_(capacity), batch_(batch) {
+
+    if(capacity == 0 || capacity > MR25H40::kSize / sizeof(QueueEntry) || base > MR25H40::kSize ||
+       footprint(capacity) > MR25H40::kSize - base) {
+
+        throw std::invalid_argument("BureauQueue: region");
+    }
+
+    if(batch == 0 || batch > capacity) {
+
+        throw std::invalid_argument("BureauQueue: batch");
+    }
+
+    items_.resize(capacity_);
+    image_.resize(size_t(capacity_) * sizeof(QueueEntry));
+    holes_.resize(capacity_);
+    mount();
+}
+
+bool BureauQueue::push(const Bureau& b) {
+
+    const uint64_t t = tail_.load(std::memory_order_relaxed);
+
+    // The slot still holds an entry the durable head has not passed
+    if(t - durable_head_.load(std::memory_order_acquire) >= capacity_) {
+
+        return false;
+    }
+
+    const uint32_t slot = uint32_t(t % capacity_);
+    QueueEntry e{};
+    e.pos = t;
+    BureauCodec::encode(b,std::span<uint8_t,BureauCodec::kSize>(e.payload,BureauCodec::kSize));
+
+    uint8_t* raw = image_.data() + size_t(slot) * sizeof(QueueEntry);
+    std::memcpy(raw,&e,sizeof(e));
+    e.crc32 = entry_crc(std::span<const uint8_t>(raw,sizeof(QueueEntry)));
+    std::memcpy(raw,&e,sizeof(e));
+    items_[slot] = b;
+
+    tail_.store(t + 1,std::memory_order_release);
+
+    if(t + 1 - flushed_ >= batch_) {
+
+        flush();
+    }
+
+    return true;
+}
+
+void BureauQueue::flush() {
+
+    const uint64_t t = tail_.load(std::memory_order_relaxed);
+
+    if(t == flushed_) {
+
+        return;
+    }
+
+    const auto bus = lock_bus();
+
+    // Entries are adjacent on the device unless the batch wraps the ring
+    for(uint64_t from = flushed_; from < t; ) {
+
+        const uint32_t slot = uint32_t(from % capacity_);
+        const uint64_t n = std::min<uint64_t>(t - from,capacity_ - slot);
+
+        prod_.write(entry_addr(from),std::span<const uint8_t>(image_.data() + size_t(slot) * sizeof(QueueEntry),size_t(n) * sizeof(QueueEntry)));
+        from += n;
+    }
+
+    flushed_ = t;
+
+    if(++flushes_ % kTailEvery == 0) {
+
+        write_checkpoint(prod_,1,++tail_seq_,flushed_);
+    }
+}
+
+void BureauQueue::checkpoint() {
+
+    flush();
+
+    const auto bus = lock_bus();
+    write_checkpoint(prod_,1,++tail_seq_,flushed_);
+}
+
+std::optional<Bureau> BureauQueue::pop() {
+
+    uint64_t h = head_.load(std::memory_order_relaxed);
+    const uint64_t t = tail_.load(std::memory_order_acquire);
+
+    if(h != t && holes_[h % capacity_]) {
+
+        // Damaged entries found by mount: passed over like popped ones
+        for(; h != t && holes_[h % capacity_]; ++h) {
+
+            holes_[h % capacity_] = 0;
+        }
+
+        head_.store(h,std::memory_order_release);
+    }
+
+    if(h == t) {
+
+        // Idle: acknowledge what was taken so far, if asked to
+        if(idle_commit_ && durable_head_.load(std::memory_order_relaxed) != h) {
+
+            commit();
+        }
+
+        return std::nullopt;
+    }
+
+    const Bureau b = items_[h % capacity_];
+    head_.store(h + 1,std::memory_order_release);
+
+    if(h + 1 - durable_head_.load(std::memory_order_relaxed) >= batch_) {
+
+        commit();
+    }
+
+    return b;
+}
+
+void BureauQueue::commit() {
+
+    const uint64_t h = head_.load(std::memory_order_relaxed);
+
+    if(h == durable_head_.load(std::memory_order_relaxed)) {
+
+        return;
+    }
+
+    {
+        const auto bus = lock_bus();
+        write_checkpoint(cons_,0,++head_seq_,h);
+    }
+
+    durable_head_.store(h,std::memory_order_release);
+}
+
+std::unique_lock<std::mutex> BureauQueue::lock_bus() {
+
+    // Separate drivers arbitrate the bus themselves
+    if(&prod_ != &cons_) {
+
+        return {};
+    }
+
+    return std::unique_lock<std::mutex>(shared_bus_);
+}
+
+void BureauQueue::mount() {
+
+    std::array<uint8_t,kMetaSize> meta{};
+    prod_.read(base_,meta);
+
+    std::array<QueueCheckpoint,4> c{};
+    std::memcpy(c.data(),meta.data(),meta.size());
+
+    const QueueCheckpoint* side[2] = {nullptr, nullptr};
+
+    for(uint16_t s = 0; s < 2; ++s) {
+
+        for(uint16_t k = 0; k < 2; ++k) {
+
+            const QueueCheckpoint& cp = c[2 * s + k];
+
+            if(valid(cp,capacity_) && cp.side == s && (!side[s] || cp.seqno > side[s]->seqno)) {
+
+                side[s] = &cp;
+            }
+        }
+    }
+
+    if(!side[0] && !side[1]) {
+
+        format();
+        return;
+    }
+
+    const uint64_t head = side[0] ? side[0]->pos : 0;
+    head_seq_ = side[0] ? side[0]->seqno : 0;
+    tail_seq_ = side[1] ? side[1]->seqno : 0;
+
+    uint64_t tail_ck = side[1] ? std::max(side[1]->pos,head) : head;
+    tail_ck = std::min<uint64_t>(tail_ck,head + capacity_);
+
+    // Whole ring in one READ: it also fills the RAM mirror
+    prod_.read(base_ + kMetaSize,image_);
+
+    uint64_t pos = head;
+    lost_ = 0;
+    std::fill(holes_.begin(),holes_.end(),0);
+
+    for(; pos < head + capacity_; ++pos) {
+
+        const uint32_t slot = uint32_t(pos % capacity_);
+        const auto raw = std::span<const uint8_t>(image_).subspan(size_t(slot) * sizeof(QueueEntry),sizeof(QueueEntry));
+        QueueEntry e{};
+        std::memcpy(&e,raw.data(),sizeof(e));
+
+        std::optional<Bureau> b;
+
+        if(e.pos == pos && e.crc32 == entry_crc(raw)) {
+
+            if(auto d = BureauCodec::try_decode(std::span<const uint8_t,BureauCodec::kSize>(e.payload,BureauCodec::kSize)); d) {
+
+                b = *d;
+            }
+        }
+
+        if(b) {
+
+            items_[slot] = *b;
+        } else if(pos < tail_ck) {
+
+            // Flushed before the tail checkpoint was written: damage, skip it
+            holes_[slot] = 1;
+            lost_++;
+        } else {
+
+            break;
+        }
+    }
+
+    scanned_ = pos - tail_ck;
+
+    head_.store(head,std::memory_order_relaxed);
+    durable_head_.store(head,std::memory_order_relaxed);
+    tail_.store(pos,std::memory_order_relaxed);
+    flushed_ = pos;
+}
+
+void BureauQueue::format() {
+
+    // Entries of an earlier queue here must not be taken for new ones
+    prod_.fill(base_ + kMetaSize,image_.size(),0);
+    std::fill(image_.begin(),image_.end(),0);
+
+    write_checkpoint(prod_,1,tail_seq_ = 1,0);
+    write_checkpoint(prod_,0,head_seq_ = 1,0);
+}
+
+void BureauQueue::write_checkpoint(MR25H40& mram, uint16_t side, uint64_t seqno, uint64_t pos) {
+
+    QueueCheckpoint c{MAGIC,VERSION,side,capacity_,0,seqno,pos};
+    c.crc32 = checkpoint_crc(c);
+
+    std::array<uint8_t,sizeof(QueueCheckpoint)> raw{};
+    std::memcpy(raw.data(),&c,sizeof(c));
+
+    // Alternate A/B by generation: a torn write leaves the other one
+    mram.write(base_ + uint32_t(2 * side + seqno % 2) * uint32_t(sizeof(QueueCheckpoint)),raw);
+}
+
+bool BureauQueue::valid(const QueueCheckpoint& c, uint32_t capacity) {
+
+    return c.magic == MAGIC && c.version == VERSION && c.capacity == capacity && c.crc32 == checkpoint_crc(c);
+}
+
+uint32_t BureauQueue::checkpoint_crc(const QueueCheckpoint& c) {
+
+    const auto* p = reinterpret_cast<const uint8_t*>(&c);
+    constexpr size_t crc_off = offsetof(QueueCheckpoint,crc32);
+    const uint32_t v = Crc32::update(~0u,std::span<const uint8_t>(p,crc_off));
+
+    return Crc32::update(v,std::span<const uint8_t>(p + crc_off + sizeof(uint32_t),sizeof(QueueCheckpoint) - crc_off - sizeof(uint32_t))) ^ ~0u;
+}
+
+uint32_t BureauQueue::entry_crc(std::span<const uint8_t> raw) {
+
+    return Crc32::calc(raw.first(offsetof(QueueEntry,crc32)));
+}
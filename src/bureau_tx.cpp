@@ -0,0 +1,222 @@
+#include "../include/bureau_tx.h"
+#include "../include/crc32.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+BureauTxStore::BureauTxStore(MR25H40& mram, uint32_t base, uint32_t keys)
+    : mram_(mram), base_(base) {
+
+    if(keys == 0 || base > MR25H40::kSize || uint64_t(footprint(keys)) > MR25H40::kSize - base) {
+
+        throw std::invalid_argument("BureauTxStore: region");
+    }
+
+    stores_.reserve(keys);
+
+    for(uint32_t k = 0; k < keys; ++k) {
+
+        stores_.emplace_back(mram_,store_base(k));
+    }
+
+    mount();
+}
+
+void BureauTxStore::begin() {
+
+    if(open_) {
+
+        throw std::runtime_error("BureauTxStore: transaction already open");
+    }
+
+    open_ = true;
+    staged_.clear();
+}
+
+void BureauTxStore::put(uint32_t key, const Bureau& b) {
+
+    if(!open_) {
+
+        throw std::runtime_error("BureauTxStore: no open transaction");
+    }
+
+    check_key(key);
+
+    auto it = std::find_if(staged_.begin(),staged_.end(),[&](const auto& e) { return e.first == key; });
+
+    if(it != staged_.end()) {
+
+        it->second = b;
+        return;
+    }
+
+    if(staged_.size() == kMaxEntries) {
+
+        throw std::overflow_error("BureauTxStore: too many records in transaction");
+    }
+
+    staged_.emplace_back(key,b);
+}
+
+void BureauTxStore::rollback() {
+
+    open_ = false;
+    staged_.clear();
+}
+
+void BureauTxStore::commit() {
+
+    if(!open_) {
+
+        throw std::runtime_error("BureauTxStore: no open transaction");
+    }
+
+    // The redo area holds one transaction: the previous one has to reach
+    // its home stores before it can be overwritten
+    apply();
+
+    std::array<uint8_t,kRedoSize> raw{};
+    const uint64_t txid = txid_ + 1;
+    const auto count = uint16_t(staged_.size());
+    std::vector<RedoEntry> entries;
+    entries.reserve(count);
+
+    for(const auto& [key,b] : staged_) {
+
+        RedoEntry e{key,0,seq_[key] + 1,{},0};
+        BureauCodec::encode(b,std::span<uint8_t,BureauCodec::kSize>(e.payload,BureauCodec::kSize));
+        entries.push_back(e);
+    }
+
+    RedoHeader h{MAGIC,VERSION,count,txid,0,0};
+    const size_t commit_off = sizeof(RedoHeader) + count * sizeof(RedoEntry);
+
+    std::memcpy(raw.data() + sizeof(RedoHeader),entries.data(),count * sizeof(RedoEntry));
+    std::memcpy(raw.data() + commit_off,&txid,sizeof(txid));
+    std::memcpy(raw.data(),&h,sizeof(h));
+    h.crc32 = redo_crc(raw,count);
+    std::memcpy(raw.data(),&h,sizeof(h));
+
+    mram_.write(redo_addr(txid),std::span<const uint8_t>(raw.data(),commit_off + sizeof(txid)));
+
+    txid_ = txid;
+    pending_ = std::move(entries);
+    rollback();
+}
+
+void BureauTxStore::apply() {
+
+    for(const auto& e : pending_) {
+
+        // Already there from an apply cut short before the crash
+        if(seq_[e.key] >= e.seqno) {
+
+            continue;
+        }
+
+        stores_[e.key].write(BureauCodec::decode(std::span<const uint8_t,BureauCodec::kSize>(e.payload,BureauCodec::kSize)));
+        seq_[e.key] = e.seqno;
+    }
+
+    pending_.clear();
+}
+
+Bureau BureauTxStore::read(uint32_t key) {
+
+    check_key(key);
+
+    if(const RedoEntry* e = find_pending(key)) {
+
+        return BureauCodec::decode(std::span<const uint8_t,BureauCodec::kSize>(e->payload,BureauCodec::kSize));
+    }
+
+    return stores_[key].read();
+}
+
+void BureauTxStore::mount() {
+
+    seq_.resize(stores_.size());
+
+    for(size_t k = 0; k < stores_.size(); ++k) {
+
+        seq_[k] = stores_[k].last_seqno();
+    }
+
+    // Both areas in one READ; the newest valid one is the last commit
+    std::array<uint8_t,2 * kRedoSize> raw{};
+    mram_.read(base_,raw);
+
+    const uint8_t* newest = nullptr;
+    RedoHeader h{};
+
+    for(uint32_t a = 0; a < 2; ++a) {
+
+        const auto area = std::span<const uint8_t>(raw).subspan(a * kRedoSize,kRedoSize);
+        RedoHeader ah{};
+
+        // Each area only ever holds txids of its parity
+        if(valid_redo(area,ah) && ah.txid % 2 == a && (!newest || ah.txid > h.txid)) {
+
+            newest = area.data();
+            h = ah;
+        }
+    }
+
+    if(!newest) {
+
+        return;
+    }
+
+    txid_ = h.txid;
+    pending_.resize(h.count);
+    std::memcpy(pending_.data(),newest + sizeof(RedoHeader),h.count * sizeof(RedoEntry));
+
+    // Entries naming keys past the current key count are dropped
+    std::erase_if(pending_,[&](const RedoEntry& e) { return e.key >= stores_.size(); });
+}
+
+void BureauTxStore::check_key(uint32_t key) const {
+
+    if(key >= stores_.size()) {
+
+        throw std::out_of_range("BureauTxStore: key");
+    }
+}
+
+bool BureauTxStore::valid_redo(std::span<const uint8_t> raw, RedoHeader& h) {
+
+    std::memcpy(&h,raw.data(),sizeof(h));
+
+    if(h.magic != MAGIC || h.version != VERSION || h.count > kMaxEntries) {
+
+        return false;
+    }
+
+    uint64_t commit = 0;
+    std::memcpy(&commit,raw.data() + sizeof(RedoHeader) + h.count * sizeof(RedoEntry),sizeof(commit));
+
+    return commit == h.txid && redo_crc(raw,h.count) == h.crc32;
+}
+
+uint32_t BureauTxStore::redo_crc(std::span<const uint8_t> raw, uint16_t count) {
+
+    constexpr size_t crc_off = offsetof(RedoHeader,crc32);
+    const size_t end = sizeof(RedoHeader) + count * sizeof(RedoEntry) + sizeof(uint64_t);
+    const uint32_t c = Crc32::update(~0u,raw.first(crc_off));
+
+    return Crc32::update(c,raw.subspan(crc_off + sizeof(uint32_t),end - crc_off - sizeof(uint32_t))) ^ ~0u;
+}
+
+const RedoEntry* BureauTxStore::find_pending(uint32_t key) const {
+
+    for(const auto& e : pending_) {
+
+        if(e.key == key) {
+
+            return &e;
+        }
+    }
+
+    return nullptr;
+}
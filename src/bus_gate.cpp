@@ -0,0 +1,106 @@
+#include "../include/bus_gate.h"
+
+#include <bit>
+#include <chrono>
+
+void LatencyHistogram::add(uint64_t v) {
+
+    buckets_[v == 0 ? 0 : std::bit_width(v)]++;
+    count_++;
+    max_ = v > max_ ? v : max_;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+
+    if(count_ == 0) {
+
+        return 0;
+    }
+
+    const uint64_t rank = uint64_t(p / 100.0 * double(count_ - 1)) + 1;
+    uint64_t seen = 0;
+
+    for(size_t i = 0; i < buckets_.size(); ++i) {
+
+        seen += buckets_[i];
+
+        if(seen >= rank) {
+
+            const uint64_t upper = i == 0 ? 0 : (i >= 64 ? UINT64_MAX : (uint64_t(1) << i) - 1);
+            return upper < max_ ? upper : max_;
+        }
+    }
+
+    return max_;
+}
+
+void BusGate::lock(BusPriority p) {
+
+    const auto t0 = std::chrono::steady_clock::now();
+    const uint64_t b0 = bytes_;
+    const auto c = size_t(p);
+
+    std::unique_lock lk(m_);
+    const uint64_t ticket = next_ticket_[c]++;
+
+    cv_.wait(lk, [&] {
+
+        return !busy_ && serving_[c] == ticket && !higher_waiting(c);
+    });
+
+    serving_[c]++;
+    busy_ = true;
+    wait_ns_[c].add(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count()));
+    wait_bytes_[c].add(bytes_ - b0);
+}
+
+void BusGate::unlock() {
+
+    {
+        std::lock_guard lk(m_);
+        busy_ = false;
+    }
+
+    cv_.notify_all();
+}
+
+uint32_t BusGate::waiting(BusPriority p) const {
+
+    std::lock_guard lk(m_);
+
+    return uint32_t(next_ticket_[size_t(p)] - serving_[size_t(p)]);
+}
+
+LatencyHistogram BusGate::wait_ns(BusPriority p) const {
+
+    std::lock_guard lk(m_);
+
+    return wait_ns_[size_t(p)];
+}
+
+LatencyHistogram BusGate::wait_bytes(BusPriority p) const {
+
+    std::lock_guard lk(m_);
+
+    return wait_bytes_[size_t(p)];
+}
+
+void BusGate::reset_stats() {
+
+    std::lock_guard lk(m_);
+    wait_ns_ = {};
+    wait_bytes_ = {};
+}
+
+bool BusGate::higher_waiting(size_t c) const {
+
+    for(size_t h = c + 1; h < kBusPriorities; ++h) {
+
+        if(next_ticket_[h] != serving_[h]) {
+
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -1,29 +1,62 @@
 #include <iostream>
 #include <cassert>
+#include <chrono>
+#include <string>
 
 #include "../test/mocks/spi_mock.h"
 #include "../test/mocks/spi_mock_p.h"
 #include "../include/spi.h"
 #include "../include/mram_mr25h40.h"
 #include "../include/bureau_store.h"
+#include "../include/mram_image.h"
+
+// mram_driver [P] [--load image] [--dump image]
 
 int main(int argc, char* argv[]) {
 
     SpiMockP spi_p;
     SpiMock spi_s;
-    Spi *spi_mock = nullptr;
-
-    if(argc == 2 && std::string(argv[1]) == "P") {
-        
-        spi_mock = &spi_p;
-    }else{
-        
-        spi_mock = &spi_s;
+    Spi *spi_mock = &spi_s;
+    std::string load_path, dump_path;
+
+    for(int i = 1; i < argc; ++i) {
+
+        const std::string arg = argv[i];
+
+        if(arg == "P") {
+
+            spi_mock = &spi_p;
+        } else if(arg == "--load" && i + 1 < argc) {
+
+            load_path = argv[++i];
+        } else if(arg == "--dump" && i + 1 < argc) {
+
+            dump_path = argv[++i];
+        } else {
+
+            std::cerr << "usage: " << argv[0] << " [P] [--load image] [--dump image]" << std::endl;
+            return 2;
+        }
     }
 
     MR25H40 mram(*spi_mock);
     mram.power_up_delay();
 
+    using Clock = std::chrono::steady_clock;
+    auto ms_since = [](Clock::time_point t0) {
+
+        return std::chrono::duration<double,std::milli>(Clock::now() - t0).count();
+    };
+
+    // --- Часть 0. Загрузка образа перед демонстрацией ---
+    if(!load_path.empty()) {
+
+        const auto t0 = Clock::now();
+        MramImage::load(mram, load_path);
+        std::cout << "Image loaded from " << load_path << " in " << ms_since(t0) << " ms" << std::endl;
+        mram.set_block_protect(MR25H40::Protect::None);
+    }
+
     BureauStore store(mram);
 
     // --- Часть 1. Базовая запись/чтение Bureau ---
@@ -78,5 +111,13 @@ int main(int argc, char* argv[]) {
         std::cout << "⚠️ Data changed (protection not active in mock)" << std::endl;
     }
 
+    // --- Часть 3. Снимок всего массива ---
+    if(!dump_path.empty()) {
+
+        const auto t0 = Clock::now();
+        MramImage::dump(mram, dump_path);
+        std::cout << "Image dumped to " << dump_path << " in " << ms_since(t0) << " ms" << std::endl;
+    }
+
     return 0;
 }
@@ -0,0 +1,201 @@
+#include "../include/mram_emulator.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+    using Defs = MR25H40Defs;
+
+    // SR bits WRSR may change: SRWD, the don't-care bits and BP1/BP0
+    constexpr uint8_t kSrWritable = 0xFC;
+
+}
+
+MR25H40Emulator::MR25H40Emulator() : own_(Defs::kSize, 0), mem_(own_) {}
+
+MR25H40Emulator::MR25H40Emulator(std::span<uint8_t> backing) : mem_(backing) {
+
+    if(backing.size() != Defs::kSize) {
+
+        throw std::invalid_argument("MR25H40Emulator: backing size");
+    }
+}
+
+void MR25H40Emulator::cs_assert() {
+
+    cs_low_ = true;
+    transactions_++;
+    state_ = State::Opcode;
+    addr_bytes_ = 0;
+    addr_ = 0;
+    new_sr_valid_ = false;
+}
+
+void MR25H40Emulator::cs_deassert() {
+
+    // WRSR takes effect when CS goes high
+    if(state_ == State::WriteStatus && new_sr_valid_) {
+
+        sr_ = uint8_t((new_sr_ & kSrWritable) | (sr_ & ~kSrWritable));
+    }
+
+    cs_low_ = false;
+    state_ = State::Opcode;
+}
+
+void MR25H40Emulator::transfer(std::span<const uint8_t> tx, std::span<uint8_t> rx) {
+
+    if(!cs_low_) {
+
+        cs_high_error();
+    }
+
+    consume(tx);
+
+    if(rx.empty()) {
+
+        return;
+    }
+
+    switch(state_) {
+
+        case State::Read:   read_data(rx); break;
+        case State::Status: std::fill(rx.begin(), rx.end(), sr_); break;
+        default:            std::fill(rx.begin(), rx.end(), 0xFF); break;  // SO not driven
+    }
+}
+
+void MR25H40Emulator::consume(std::span<const uint8_t> tx) {
+
+    size_t i = 0;
+
+    while(i < tx.size()) {
+
+        switch(state_) {
+
+            case State::Opcode:
+                opcode(tx[i++]);
+                break;
+
+            case State::Address:
+                addr_ = (addr_ << 8) | tx[i++];
+
+                if(++addr_bytes_ == 3) {
+
+                    addr_ &= Defs::kSize - 1;
+
+                    if(op_ == Defs::READ) {
+
+                        state_ = State::Read;
+                    } else if(sr_ & Defs::SR_WEL) {
+
+                        state_ = State::Write;
+                        wr_limit_ = Defs::protected_start(sr_);
+                    } else {
+
+                        state_ = State::Ignore;
+                    }
+                }
+                break;
+
+            case State::Write:
+                write_data(tx.subspan(i));
+                i = tx.size();
+                break;
+
+            case State::WriteStatus:
+                if(!new_sr_valid_) {
+
+                    new_sr_ = tx[i];
+                    new_sr_valid_ = true;
+                }
+                i = tx.size();
+                break;
+
+            // Bytes clocked in while the device is talking are don't-care
+            case State::Read:
+            case State::Status:
+            case State::Ignore:
+                i = tx.size();
+                break;
+        }
+    }
+}
+
+void MR25H40Emulator::opcode(uint8_t op) {
+
+    op_ = op;
+    state_ = State::Ignore;
+
+    if(sleeping_ && op != Defs::WAK) {
+
+        return;
+    }
+
+    switch(op) {
+
+        case Defs::WREN: sr_ |= Defs::SR_WEL; break;
+        case Defs::WRDI: sr_ &= uint8_t(~Defs::SR_WEL); break;
+        case Defs::RDSR: state_ = State::Status; break;
+        case Defs::SLP:  sleeping_ = true; break;
+        case Defs::WAK:  sleeping_ = false; break;
+
+        case Defs::WRSR:
+            // Hardware protected mode: SRWD set and WP held low
+            if((sr_ & Defs::SR_WEL) && !((sr_ & Defs::SR_WD) && !wp_)) {
+
+                state_ = State::WriteStatus;
+            }
+            break;
+
+        case Defs::READ:
+        case Defs::WRITE:
+            state_ = State::Address;
+            break;
+
+        default: break;
+    }
+}
+
+void MR25H40Emulator::write_data(std::span<const uint8_t> data) {
+
+    const size_t n = std::min(data.size(), write_budget_);
+    write_budget_ -= write_budget_ == SIZE_MAX ? 0 : n;
+    data = data.first(n);
+
+    while(!data.empty()) {
+
+        const size_t run = std::min(data.size(), size_t(Defs::kSize - addr_));
+
+        if(addr_ < wr_limit_) {
+
+            std::memcpy(mem_.data() + addr_, data.data(), std::min(run, size_t(wr_limit_ - addr_)));
+        }
+
+        addr_ = uint32_t((addr_ + run) & (Defs::kSize - 1));
+        data = data.subspan(run);
+    }
+}
+
+void MR25H40Emulator::read_data(std::span<uint8_t> out) {
+
+    while(!out.empty()) {
+
+        const size_t run = std::min(out.size(), size_t(Defs::kSize - addr_));
+        std::memcpy(out.data(), mem_.data() + addr_, run);
+        addr_ = uint32_t((addr_ + run) & (Defs::kSize - 1));
+        out = out.subspan(run);
+    }
+}
+
+void MR25H40Emulator::cs_high_error() {
+
+#if MRAM_FREESTANDING
+    std::abort();
+#else
+    throw std::runtime_error("MR25H40Emulator: transfer with CS high");
+#endif
+}
@@ -0,0 +1,3 @@
+#include "../include/mram_heap.h"
+
+template class BasicMramHeap<Spi>;
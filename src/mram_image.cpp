@@ -0,0 +1,201 @@
+#include "../include/mram_image.h"
+#include "../include/crc32.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+#if __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define MRAM_IMAGE_MMAP 1
+#else
+#define MRAM_IMAGE_MMAP 0
+#endif
+
+MramImageFile::MramImageFile(const std::string& path) {
+
+#if MRAM_IMAGE_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+
+    if(fd < 0) {
+
+        throw std::runtime_error("MramImage: cannot open " + path);
+    }
+
+    struct stat st{};
+
+    if(::fstat(fd, &st) == 0 && st.st_size > 0) {
+
+        void* p = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if(p != MAP_FAILED) {
+
+            base_ = static_cast<const uint8_t*>(p);
+            len_ = size_t(st.st_size);
+            mapped_ = true;
+        }
+    }
+
+    ::close(fd);
+#endif
+
+    if(!mapped_) {
+
+        std::ifstream f(path, std::ios::binary);
+
+        if(!f) {
+
+            throw std::runtime_error("MramImage: cannot open " + path);
+        }
+
+        copy_.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+        base_ = copy_.data();
+        len_ = copy_.size();
+    }
+
+    if(len_ < sizeof(ImageHeader)) {
+
+        unmap();
+        throw std::runtime_error("MramImage: truncated file");
+    }
+
+    std::memcpy(&hdr_, base_, sizeof(hdr_));
+
+    if(hdr_.magic != MramImage::kMagic || hdr_.version != MramImage::kVersion ||
+       hdr_.size != MR25H40::kSize || len_ - sizeof(ImageHeader) != hdr_.size) {
+
+        unmap();
+        throw std::runtime_error("MramImage: bad header");
+    }
+}
+
+MramImageFile::~MramImageFile() {
+
+    unmap();
+}
+
+void MramImageFile::unmap() {
+
+#if MRAM_IMAGE_MMAP
+    if(mapped_) {
+
+        ::munmap(const_cast<uint8_t*>(base_), len_);
+        mapped_ = false;
+        base_ = nullptr;
+    }
+#endif
+}
+
+bool MramImageFile::verify() const {
+
+    return Crc32::calc(data()) == hdr_.crc32;
+}
+
+void MramImage::dump(MR25H40& mram, const std::string& path, size_t chunk) {
+
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+
+    if(!f) {
+
+        throw std::runtime_error("MramImage: cannot create " + path);
+    }
+
+    ImageHeader h{kMagic, kVersion, mram.read_status(), 0, uint32_t(MR25H40::kSize), 0};
+    uint32_t crc = ~0u;
+
+    // Header slot first, the CRC is patched in once the stream is done
+    f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+    mram.read_stream(0, MR25H40::kSize, chunk, [&](uint32_t, std::span<const uint8_t> data) {
+
+        crc = Crc32::update(crc, data);
+        f.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+    });
+
+    h.crc32 = crc ^ ~0u;
+    f.seekp(0);
+    f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+    if(!f.flush()) {
+
+        throw std::runtime_error("MramImage: write failed " + path);
+    }
+}
+
+void MramImage::load(MR25H40& mram, const std::string& path, size_t chunk) {
+
+    MramImageFile img(path);
+
+    if(!img.verify()) {
+
+        throw std::runtime_error("MramImage: CRC mismatch");
+    }
+
+    if(chunk == 0) {
+
+        throw std::invalid_argument("MramImage: chunk");
+    }
+
+    constexpr uint8_t lock = MR25H40::SR_BP0 | MR25H40::SR_BP1 | MR25H40::SR_WD;
+
+    // BP bits of the current state would drop writes to the protected part.
+    // With SRWD set and WP low the WRSR itself is ignored, so check it took
+    mram.write_status(0);
+
+    if(mram.read_status() & lock) {
+
+        throw std::runtime_error("MramImage: status register locked");
+    }
+
+    const auto data = img.data();
+
+    for(size_t off = 0; off < data.size(); off += chunk) {
+
+        mram.write(uint32_t(off), data.subspan(off, std::min(chunk, data.size() - off)));
+    }
+
+    // Read the array back as dump() does: any dropped WRITE shows up here
+    uint32_t crc = ~0u;
+
+    mram.read_stream(0, data.size(), chunk, [&](uint32_t, std::span<const uint8_t> got) {
+
+        crc = Crc32::update(crc, got);
+    });
+
+    if((crc ^ ~0u) != img.header().crc32) {
+
+        throw std::runtime_error("MramImage: device does not match image");
+    }
+
+    // A restored SRWD locks the register again once WP is low
+    const uint8_t sr = img.header().sr & ~MR25H40::SR_WEL;
+    mram.write_status(sr);
+
+    if((mram.read_status() & lock) != (sr & lock)) {
+
+        throw std::runtime_error("MramImage: status register not restored");
+    }
+}
+
+uint8_t MramImage::load_into(std::span<uint8_t> mem, const std::string& path) {
+
+    MramImageFile img(path);
+
+    if(!img.verify()) {
+
+        throw std::runtime_error("MramImage: CRC mismatch");
+    }
+
+    if(mem.size() < img.data().size()) {
+
+        throw std::invalid_argument("MramImage: backend memory");
+    }
+
+    std::memcpy(mem.data(), img.data().data(), img.data().size());
+
+    return img.header().sr & ~MR25H40::SR_WEL;
+}
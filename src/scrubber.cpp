@@ -0,0 +1,164 @@
+#include "../include/scrubber.h"
+#include "../include/bureau_store.h"
+#include "../include/crc32.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+ScrubTarget ScrubTargets::store_records() {
+
+    return {"store.records", BureauStore::SLOT_A, BureauStore::SLOT_SZ, 2, &BureauStore::check_record_slot};
+}
+
+ScrubTarget ScrubTargets::history(uint32_t base, uint32_t size) {
+
+    return {"history", base, BureauHistory::kBlockSize, size / BureauHistory::kBlockSize, &BureauHistory::check_block};
+}
+
+Scrubber::Scrubber(Spi& bus, BusGate& gate, std::vector<ScrubTarget> targets, ScrubConfig cfg, CorruptCallback on_corrupt)
+    : spi_(bus, gate, cfg.priority), mram_(spi_), targets_(std::move(targets)), cfg_(cfg), on_corrupt_(std::move(on_corrupt)) {
+
+    for(const auto& t : targets_) {
+
+        if(t.slot_size == 0 || !t.check || t.base > MR25H40::kSize ||
+           uint64_t(t.slot_size) * t.slots > MR25H40::kSize - t.base) {
+
+            throw std::invalid_argument("Scrubber: target");
+        }
+    }
+}
+
+Scrubber::~Scrubber() {
+
+    stop();
+}
+
+void Scrubber::start() {
+
+    if(thread_.joinable()) {
+
+        return;
+    }
+
+    {
+        std::lock_guard lk(m_);
+        stop_ = false;
+    }
+
+    thread_ = std::thread([this] {
+
+        while(run_pass()) {
+
+            if(!sleep_until(std::chrono::steady_clock::now() + cfg_.pass_interval)) {
+
+                return;
+            }
+        }
+    });
+}
+
+void Scrubber::stop() {
+
+    {
+        std::lock_guard lk(m_);
+        stop_ = true;
+    }
+
+    cv_.notify_all();
+
+    if(thread_.joinable()) {
+
+        thread_.join();
+    }
+}
+
+bool Scrubber::run_pass() {
+
+    due_ = std::chrono::steady_clock::now();
+    std::vector<uint8_t> buf;
+    std::unordered_map<uint32_t,uint32_t> next_suspects;
+
+    for(const auto& t : targets_) {
+
+        const uint32_t per_read = std::max<uint32_t>(1, cfg_.chunk / t.slot_size);
+        buf.resize(size_t(per_read) * t.slot_size);
+
+        for(uint32_t i = 0; i < t.slots; i += per_read) {
+
+            const uint32_t n = std::min(per_read, t.slots - i);
+            const uint32_t addr = t.base + i * t.slot_size;
+            mram_.read(addr, std::span<uint8_t>(buf.data(), size_t(n) * t.slot_size));
+            bytes_ += size_t(n) * t.slot_size;
+
+            for(uint32_t j = 0; j < n; ++j) {
+
+                std::span<const uint8_t> slot(buf.data() + size_t(j) * t.slot_size, t.slot_size);
+                const uint32_t slot_addr = addr + j * t.slot_size;
+
+                if(t.check(slot) != SlotState::Corrupt) {
+
+                    reported_.erase(slot_addr);
+                    continue;
+                }
+
+                // Same bad bytes on two passes in a row: not a write in flight
+                const uint32_t h = Crc32::calc(slot);
+                auto it = suspects_.find(slot_addr);
+
+                if(it != suspects_.end() && it->second == h) {
+
+                    auto [rit, fresh] = reported_.try_emplace(slot_addr, h);
+
+                    if(fresh || rit->second != h) {
+
+                        rit->second = h;
+                        corrupt_++;
+
+                        if(on_corrupt_) {
+
+                            on_corrupt_(t, i + j, slot_addr);
+                        }
+                    }
+                }
+
+                next_suspects[slot_addr] = h;
+            }
+
+            slots_ += n;
+
+            if(!pace(size_t(n) * t.slot_size)) {
+
+                return false;
+            }
+        }
+    }
+
+    suspects_ = std::move(next_suspects);
+    passes_++;
+
+    return true;
+}
+
+bool Scrubber::pace(size_t bytes) {
+
+    if(cfg_.bytes_per_sec == 0) {
+
+        std::lock_guard lk(m_);
+        return !stop_;
+    }
+
+    // Next READ is due once this one is paid for; idle time earns no credit
+    const auto now = std::chrono::steady_clock::now();
+    due_ = std::max(due_, now - std::chrono::milliseconds(1)) +
+           std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+               std::chrono::duration<double>(double(bytes) / cfg_.bytes_per_sec));
+
+    return sleep_until(due_);
+}
+
+bool Scrubber::sleep_until(std::chrono::steady_clock::time_point t) {
+
+    std::unique_lock lk(m_);
+
+    return !cv_.wait_until(lk, t, [this] { return stop_; });
+}
@@ -5,11 +5,13 @@
 #include <cstdint>
 #include <span>
 #include <array>
+#include <algorithm>
+#include <cstdlib>
 
 #include "../../include/spi.h"
 #include "../../include/mram_mr25h40.h"
 
-class SpiMock : public Spi {
+class SpiMock final : public Spi {
 public:
 
     SpiMock() : mem(MR25H40::kSize) {}
@@ -18,7 +20,11 @@ public:
 
         if(!cs_low) {
             
+#if MRAM_FREESTANDING
+            std::abort();
+#else
             throw std::runtime_error("CS high");
+#endif
         }
 
         for(uint8_t b : tx) {
@@ -40,9 +46,10 @@ public:
                 
                 for(size_t i = 0; i < rx.size(); ++i){
                     
-                    rx[i]=mem.at(a+i);
+                    rx[i]=mem.at(a+rd_off+i);
                 }
                 
+                rd_off += rx.size();
                 return;
             }
 
@@ -51,7 +58,7 @@ public:
     }
     void cs_assert() override {
         
-        cs_low = true;inbuf.clear();
+        cs_low = true;inbuf.clear();rd_off = 0;++transactions;
     }
 
     void cs_deassert() override {
@@ -85,7 +92,7 @@ public:
                         
                         uint32_t a = (inbuf[1] << 16) | (inbuf[2] << 8) | inbuf[3];
                         
-                        for(size_t i = 4; i < inbuf.size(); ++i) {
+                        for(size_t i = 4; i < inbuf.size() && write_budget > 0; ++i, --write_budget) {
                             
                             mem.at(a + i - 4) = inbuf[i];
                         }
@@ -115,5 +122,8 @@ public:
     bool cs_low = false; 
     bool sleeping = false; 
     std::vector<uint8_t> inbuf;
+    size_t rd_off = 0;          // bytes already clocked out by the current READ
+    size_t transactions = 0;    // CS assertions seen
+    size_t write_budget = SIZE_MAX; // data bytes WRITEs may still store: simulates a power cut
 
 };//class_SpiMock
@@ -5,15 +5,17 @@
 #include <cstdint>
 #include <span>
 #include <array>
+#include <cstdlib>
 
 #include "../../include/spi.h"
 #include "../../include/mram_mr25h40.h"
 
-class SpiMockP : public Spi {
+class SpiMockP final : public Spi {
 
     std::vector<uint8_t> mem;
     bool cs_low = false;
     std::vector<uint8_t> inbuf;
+    size_t rd_off = 0;
     uint8_t sr = 0;
 
     uint32_t start_protected() const {
@@ -37,7 +39,11 @@ public:
         
         if(!cs_low) {
             
+#if MRAM_FREESTANDING
+            std::abort();
+#else
             throw std::runtime_error("CS high during transfer");
+#endif
         }
         // Накопим переданные данные
         inbuf.insert(inbuf.end(), tx.begin(), tx.end());
@@ -54,6 +60,8 @@ public:
 
             uint32_t addr = (uint32_t(inbuf[1]) << 16) | (uint32_t(inbuf[2]) << 8) | inbuf[3];
             
+            addr += uint32_t(rd_off);
+
             for(size_t i = 0; i < rx.size(); ++i) {
 
                 if(addr + i < mem.size()) {
@@ -64,6 +72,9 @@ public:
                     rx[i] = 0xFF;
                 }
             }
+
+            // Следующий transfer в той же транзакции продолжает чтение
+            rd_off += rx.size();
         }
     }
 
@@ -71,6 +82,7 @@ public:
 
         cs_low = true; 
         inbuf.clear(); 
+        rd_off = 0;
     }
 
     void cs_deassert() override {
@@ -0,0 +1,331 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "../../include/bureau_history.h"
+#include "../../include/mram_mr25h40.h"
+#include "../../include/mram_emulator.h"
+#include "../mocks/spi_mock.h"
+
+static Bureau snapshot(uint64_t i) {
+    Bureau b{};
+    b.prog_qty = 100000 + i * 3;
+    b.math_qty = 5000 + uint32_t(i);
+    b.head_qty = uint8_t(10 + (i / 50));
+    b.salary_sum = 1000.0f + float(i) * 0.25f;
+    return b;
+}
+
+static void expect_same(const Bureau& a, const Bureau& b) {
+    EXPECT_EQ(a.prog_qty, b.prog_qty);
+    EXPECT_EQ(a.math_qty, b.math_qty);
+    EXPECT_EQ(a.head_qty, b.head_qty);
+    EXPECT_EQ(a.salary_sum, b.salary_sum);
+}
+
+TEST(HistoryCodec, DeltaRoundTripIncludingNegativeAndWrap) {
+    Bureau prev{.prog_qty = 5, .math_qty = 0xFFFFFFFFu, .head_qty = 255, .salary_sum = -3.5f};
+    Bureau cur{.prog_qty = 2, .math_qty = 0, .head_qty = 0, .salary_sum = 1e30f};
+
+    std::array<uint8_t, HistoryCodec::kMaxDelta> buf{};
+    size_t n = HistoryCodec::encode_delta(prev, cur, buf);
+    ASSERT_LE(n, HistoryCodec::kMaxDelta);
+
+    Bureau r = prev;
+    size_t pos = 0;
+    HistoryCodec::decode_delta(std::span<const uint8_t>(buf.data(), n), pos, r);
+    EXPECT_EQ(pos, n);
+    expect_same(r, cur);
+}
+
+TEST(HistoryCodec, SmallIncrementsTakeFewBytes) {
+    std::array<uint8_t, HistoryCodec::kMaxDelta> buf{};
+    EXPECT_LE(HistoryCodec::encode_delta(snapshot(7), snapshot(8), buf), 6u);
+}
+
+TEST(BureauHistory, AppendThenReadEverySnapshot) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    BureauHistory h(mram);
+
+    EXPECT_TRUE(h.empty());
+    for (uint64_t i = 0; i < 1000; ++i) EXPECT_EQ(h.append(snapshot(i)), i + 1);
+
+    EXPECT_EQ(h.first_seqno(), 1u);
+    EXPECT_EQ(h.last_seqno(), 1000u);
+    for (uint64_t i = 0; i < 1000; ++i) expect_same(h.at(i + 1), snapshot(i));
+
+    // 1000 plain 256-byte slots vs. delta blocks: expect at least 5x denser
+    EXPECT_LE(h.live_blocks() * 5u, 1000u * (sizeof(HistoryBlockHeader) + BureauCodec::kSize) / BureauHistory::kBlockSize);
+    EXPECT_THROW(h.at(0), std::out_of_range);
+    EXPECT_THROW(h.at(1001), std::out_of_range);
+}
+
+TEST(BureauHistory, RemountRestoresAndContinues) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+
+    {
+        BureauHistory h(mram);
+        for (uint64_t i = 0; i < 300; ++i) h.append(snapshot(i));
+    }
+
+    BureauHistory h2(mram);
+    EXPECT_EQ(h2.first_seqno(), 1u);
+    EXPECT_EQ(h2.last_seqno(), 300u);
+    EXPECT_EQ(h2.append(snapshot(300)), 301u);
+    for (uint64_t i = 0; i < 301; ++i) expect_same(h2.at(i + 1), snapshot(i));
+}
+
+TEST(BureauHistory, RingEvictsOldestBlocks) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    const uint32_t base = 0x2000, size = 4 * BureauHistory::kBlockSize;
+
+    {
+        BureauHistory h(mram, base, size);
+        for (uint64_t i = 0; i < 2000; ++i) h.append(snapshot(i * 1000));
+        EXPECT_EQ(h.live_blocks(), 4u);
+        EXPECT_GT(h.first_seqno(), 1u);
+        EXPECT_THROW(h.at(1), std::out_of_range);
+    }
+
+    BureauHistory h(mram, base, size);
+    EXPECT_EQ(h.last_seqno(), 2000u);
+    for (uint64_t s = h.first_seqno(); s <= h.last_seqno(); ++s) expect_same(h.at(s), snapshot((s - 1) * 1000));
+}
+
+TEST(BureauHistory, PowerCutAtEveryByteKeepsAppendedRecords) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    const uint32_t base = 0x2000, size = 8 * BureauHistory::kBlockSize;
+    const auto region = emu.memory().subspan(base, size);
+
+    // Every snapshot s - 1 at seqno s, nothing else
+    auto expect_prefix = [&](BureauHistory& h) {
+        uint64_t next = 1;
+        h.scan(0, UINT64_MAX, [&](uint64_t s, const Bureau& b) {
+            ASSERT_EQ(s, next++);
+            expect_same(b, snapshot(s - 1));
+        });
+        EXPECT_EQ(next, h.last_seqno() + 1);
+    };
+
+    uint64_t n = 0;
+    uint32_t blocks = 0;
+    {
+        BureauHistory h(mram, base, size);
+        while (n < 40) h.append(snapshot(n++));
+        blocks = h.live_blocks();
+    }
+
+    // 40 appends cross a block boundary (fill + header WRITE)
+    for (int k = 0; k < 40; ++k) {
+        const std::vector<uint8_t> saved(region.begin(), region.end());
+
+        // Every byte of a delta, then coarser through the block-opening WRITEs
+        for (size_t cut = 0; cut <= BureauHistory::kBlockSize + 64; cut += cut <= HistoryCodec::kMaxDelta + 1 ? 1 : 5) {
+            std::copy(saved.begin(), saved.end(), region.begin());
+
+            {
+                BureauHistory h(mram, base, size);
+                emu.cut_power_after(cut);
+                h.append(snapshot(n));
+                emu.restore_power();
+            }
+
+            {
+                BureauHistory h(mram, base, size);
+                ASSERT_GE(h.last_seqno(), n) << "append " << n << " cut " << cut;
+                ASSERT_LE(h.last_seqno(), n + 1);
+                expect_prefix(h);
+
+                // The next append lands cleanly after whatever the cut left
+                h.append(snapshot(h.last_seqno()));
+            }
+
+            BureauHistory h(mram, base, size);
+            expect_prefix(h);
+        }
+
+        std::copy(saved.begin(), saved.end(), region.begin());
+        BureauHistory h(mram, base, size);
+        h.append(snapshot(n++));
+    }
+
+    EXPECT_GT(BureauHistory(mram, base, size).live_blocks(), blocks);
+}
+
+TEST(BureauHistory, WriteProtectedBlockFailsAppendAndMount) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    const uint32_t size = 4 * BureauHistory::kBlockSize, base = MR25H40::kSize - size;
+
+    {
+        BureauHistory h(mram, base, size);
+        mram.set_block_protect(MR25H40::Protect::UpperQuarter);
+        EXPECT_THROW(h.append(snapshot(0)), std::out_of_range);  // the block clear falls short
+        EXPECT_TRUE(h.empty());
+
+        mram.set_block_protect(MR25H40::Protect::None);
+        EXPECT_EQ(h.append(snapshot(0)), 1u);
+        EXPECT_EQ(h.append(snapshot(1)), 2u);
+    }
+
+    // Leftovers of a cut append can no longer be cleared
+    emu.memory()[base + BureauHistory::kBlockSize - 1] = 0x77;
+    mram.set_block_protect(MR25H40::Protect::UpperQuarter);
+    EXPECT_THROW(BureauHistory(mram, base, size), std::out_of_range);
+
+    mram.set_block_protect(MR25H40::Protect::None);
+    BureauHistory h(mram, base, size);
+    EXPECT_EQ(h.last_seqno(), 2u);
+    EXPECT_EQ(emu.memory()[base + BureauHistory::kBlockSize - 1], 0u);
+}
+
+TEST(BureauHistory, RejectsBadRegion) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    EXPECT_THROW(BureauHistory(mram, MR25H40::kSize - 256, 1024), std::invalid_argument);
+    EXPECT_THROW(BureauHistory(mram, 0, BureauHistory::kBlockSize), std::invalid_argument);
+}
+
+// --- Range queries ---
+
+TEST(HistoryQuery, ScanVisitsExactRangeWithBulkReads) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    BureauHistory h(mram);
+    for (uint64_t i = 0; i < 1000; ++i) h.append(snapshot(i));
+
+    for (uint32_t batch : {1u, 3u, 8u, 64u}) {
+        uint64_t expect = 120;
+        const size_t before = spi.transactions;
+        h.scan(120, 870, [&](uint64_t s, const Bureau& b) {
+            ASSERT_EQ(s, expect);
+            expect_same(b, snapshot(s - 1));
+            ++expect;
+        }, batch);
+        EXPECT_EQ(expect, 871u);
+        EXPECT_LE(spi.transactions - before, h.live_blocks() / batch + 2) << "batch " << batch;
+    }
+
+    // Clamped to what is held
+    uint64_t n = 0;
+    h.scan(0, 5000, [&](uint64_t, const Bureau&) { ++n; });
+    EXPECT_EQ(n, 1000u);
+    h.scan(10, 9, [&](uint64_t, const Bureau&) { FAIL(); });
+}
+
+TEST(HistoryQuery, AggregatesMatchBruteForce) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    BureauHistory h(mram);
+    for (uint64_t i = 0; i < 700; ++i) h.append(snapshot(i));
+
+    auto [from, to] = HistoryQuery::last_n(h, 250);
+    EXPECT_EQ(from, 451u);
+    EXPECT_EQ(to, 700u);
+
+    double salary = 0;
+    uint64_t head_max = 0, prog_min = UINT64_MAX, math_sum = 0;
+    for (uint64_t s = from; s <= to; ++s) {
+        Bureau b = snapshot(s - 1);
+        salary += b.salary_sum;
+        head_max = std::max<uint64_t>(head_max, b.head_qty);
+        prog_min = std::min<uint64_t>(prog_min, b.prog_qty);
+        math_sum += b.math_qty;
+    }
+
+    auto a = HistoryQuery::aggregate(h, from, to);
+    EXPECT_EQ(a.first_seqno, from);
+    EXPECT_EQ(a.last_seqno, to);
+    EXPECT_EQ(a.count(), 250u);
+    EXPECT_DOUBLE_EQ(a.salary.sum, salary);
+    EXPECT_EQ(a[HistoryQuery::Field::HeadQty].max, head_max);
+    EXPECT_EQ(a[HistoryQuery::Field::ProgQty].min, prog_min);
+    EXPECT_EQ(a[HistoryQuery::Field::MathQty].sum, (HistoryQuery::Sum128{0, math_sum}));
+
+    // Scan-free count; one pass per field for the rest
+    const size_t before = spi.transactions;
+    EXPECT_EQ(HistoryQuery::count(h, from, to), 250u);
+    EXPECT_EQ(HistoryQuery::count(h, 0, UINT64_MAX), 700u);
+    EXPECT_EQ(spi.transactions, before);
+
+    auto head = HistoryQuery::stats(h, from, to, HistoryQuery::Field::HeadQty);
+    EXPECT_EQ(head.count, 250u);
+    EXPECT_EQ(head.max, head_max);
+    EXPECT_DOUBLE_EQ(HistoryQuery::salary_stats(h, from, to).sum, salary);
+
+    EXPECT_EQ(HistoryQuery::aggregate(h, 800, 900)[HistoryQuery::Field::MathQty].count, 0u);
+    EXPECT_EQ(HistoryQuery::count(h, 800, 900), 0u);
+}
+
+TEST(HistoryQuery, Sum128CarriesAtEveryWrap) {
+    HistoryQuery::Sum128 s{};
+    s.add(UINT64_MAX);
+    EXPECT_EQ(s, (HistoryQuery::Sum128{0, UINT64_MAX}));
+    s.add(1);
+    EXPECT_EQ(s, (HistoryQuery::Sum128{1, 0}));
+    s.add(UINT64_MAX);
+    s.add(UINT64_MAX);
+    EXPECT_EQ(s, (HistoryQuery::Sum128{2, UINT64_MAX - 1}));
+    s.add(0);
+    EXPECT_EQ(s.hi, 2u);
+}
+
+TEST(HistoryQuery, IntegerSumsStayExactAbove2To53) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    BureauHistory h(mram);
+
+    // Every term is odd and above 2^60: a double sum would round
+    const uint64_t big = (uint64_t(1) << 60) + 1;
+    for (uint64_t i = 0; i < 64; ++i) {
+        Bureau b = snapshot(i);
+        b.prog_qty = size_t(big + 2 * i);
+        h.append(b);
+    }
+
+    // 64 * (2^60 + 1) + 2 * (0 + ... + 63) = 2^66 + 4096: carried past 64 bits
+    auto st = HistoryQuery::stats(h, 0, UINT64_MAX, HistoryQuery::Field::ProgQty);
+    EXPECT_EQ(st.sum.hi, 4u);
+    EXPECT_EQ(st.sum.lo, 4096u);
+    EXPECT_EQ(st.min, big);
+    EXPECT_EQ(st.max, big + 126);
+}
+
+TEST(HistoryQuery, CustomReducerAcrossRingWrap) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    BureauHistory h(mram, 0x2000, 5 * BureauHistory::kBlockSize);
+    for (uint64_t i = 0; i < 400; ++i) h.append(snapshot(i));
+
+    // Count snapshots whose math_qty is even, and check seqno continuity
+    struct Acc { uint64_t even = 0; uint64_t prev = 0; bool ordered = true; };
+    Acc r = HistoryQuery::reduce(h, 0, UINT64_MAX, Acc{}, [](Acc a, uint64_t s, const Bureau& b) {
+        a.ordered = a.ordered && (a.prev == 0 || s == a.prev + 1);
+        a.prev = s;
+        a.even += (b.math_qty % 2 == 0);
+        return a;
+    });
+
+    uint64_t even = 0;
+    for (uint64_t s = h.first_seqno(); s <= h.last_seqno(); ++s) even += (snapshot(s - 1).math_qty % 2 == 0);
+    EXPECT_TRUE(r.ordered);
+    EXPECT_EQ(r.prev, 400u);
+    EXPECT_EQ(r.even, even);
+}
+
+TEST(HistoryQuery, ScanReportsCorruptBlock) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    BureauHistory h(mram);
+    for (uint64_t i = 0; i < 300; ++i) h.append(snapshot(i));
+
+    spi.mem[BureauHistory::kDefaultBase + sizeof(HistoryBlockHeader) + 30] ^= 0x01;
+    EXPECT_THROW(h.scan(1, 300, [](uint64_t, const Bureau&) {}), std::runtime_error);
+}
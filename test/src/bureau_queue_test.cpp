@@ -0,0 +1,289 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../../include/bureau_queue.h"
+#include "../../include/bus_gate.h"
+#include "../../include/mram_emulator.h"
+#include "../../include/mram_mr25h40.h"
+
+static Bureau make_bureau(size_t prog) {
+    return Bureau{.prog_qty = prog, .math_qty = uint32_t(prog * 3), .head_qty = uint8_t(prog), .salary_sum = float(prog)};
+}
+
+static constexpr uint32_t kBase = 0x30000;
+
+TEST(BureauQueue, OneWritePerBatch) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    BureauQueue q(mram, kBase, 64, 8);
+
+    size_t before = emu.transactions();
+    for (size_t i = 0; i < 7; ++i) ASSERT_TRUE(q.push(make_bureau(i)));
+    EXPECT_EQ(emu.transactions(), before);  // RAM only
+    EXPECT_EQ(q.size(), 7u);
+    EXPECT_EQ(q.flushed(), 0u);
+
+    ASSERT_TRUE(q.push(make_bureau(7)));
+    EXPECT_EQ(emu.transactions() - before, 2u);  // WREN + WRITE of 8 entries
+    EXPECT_EQ(q.flushed(), 8u);
+
+    before = emu.transactions();
+    for (size_t i = 0; i < 7; ++i) EXPECT_EQ(q.pop()->prog_qty, i);
+    EXPECT_EQ(emu.transactions(), before);
+    EXPECT_EQ(q.pop()->prog_qty, 7u);
+    EXPECT_EQ(emu.transactions() - before, 2u);  // head checkpoint
+    EXPECT_EQ(q.durable_head(), 8u);
+
+    EXPECT_FALSE(q.pop().has_value());
+    EXPECT_EQ(q.size(), 0u);
+}
+
+TEST(BureauQueue, TrickleLoadCheckpointsPerBatchUnlessIdleCommit) {
+    // One item at a time: push, flush, pop it, then find the queue empty
+    for (bool idle : {false, true}) {
+        MR25H40Emulator emu;
+        MR25H40 mram(emu);
+        BureauQueue q(mram, kBase, 64, 8);
+        q.set_idle_commit(idle);
+        size_t consumer = 0;
+
+        for (size_t i = 0; i < 32; ++i) {
+            ASSERT_TRUE(q.push(make_bureau(i)));
+            q.flush();
+            const size_t before = emu.transactions();
+            ASSERT_EQ(q.pop()->prog_qty, i);
+            ASSERT_FALSE(q.pop().has_value());
+            consumer += emu.transactions() - before;
+        }
+
+        // WREN + WRITE per head checkpoint
+        EXPECT_EQ(consumer, idle ? 2u * 32 : 2u * 32 / 8) << "idle " << idle;
+        EXPECT_EQ(q.durable_head(), 32u);
+    }
+}
+
+TEST(BureauQueue, FullUntilHeadCheckpointPassesSlot) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    BureauQueue q(mram, kBase, 8, 4);
+
+    for (size_t i = 0; i < 8; ++i) ASSERT_TRUE(q.push(make_bureau(i)));
+    EXPECT_FALSE(q.push(make_bureau(8)));
+
+    for (size_t i = 0; i < 3; ++i) q.pop();
+    EXPECT_FALSE(q.push(make_bureau(8)));  // popped, not yet checkpointed
+    q.pop();
+    EXPECT_TRUE(q.push(make_bureau(8)));
+}
+
+TEST(BureauQueue, RecoveryResumesAfterCheckpointAndScan) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+
+    {
+        BureauQueue q(mram, kBase, 64, 4);
+        for (size_t i = 0; i < 22; ++i) q.push(make_bureau(i));  // 5 batches, 2 staged
+        for (size_t i = 0; i < 5; ++i) q.pop();                  // head checkpoint at 4
+    }
+
+    BureauQueue q(mram, kBase, 64, 4);
+    EXPECT_EQ(q.head(), 4u);
+    EXPECT_EQ(q.tail(), 20u);  // unflushed items are gone
+    EXPECT_EQ(q.scanned(), 16u);  // no tail checkpoint yet: all found by the scan
+    EXPECT_EQ(q.lost(), 0u);
+
+    // Item 4 was popped but not acknowledged: delivered again
+    for (size_t i = 4; i < 20; ++i) EXPECT_EQ(q.pop()->prog_qty, i);
+    EXPECT_FALSE(q.pop().has_value());
+
+    q.push(make_bureau(20));
+    q.checkpoint();
+
+    BureauQueue again(mram, kBase, 64, 4);
+    EXPECT_EQ(again.head(), 20u);
+    EXPECT_EQ(again.tail(), 21u);
+    EXPECT_EQ(again.scanned(), 0u);
+    EXPECT_EQ(again.pop()->prog_qty, 20u);
+}
+
+TEST(BureauQueue, WrapsAcrossManyLapsAndRemounts) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    size_t next_in = 0, next_out = 0;
+
+    for (int round = 0; round < 6; ++round) {
+        BureauQueue q(mram, kBase, 16, 5);
+        ASSERT_EQ(q.head(), next_out);
+
+        for (int i = 0; i < 37; ++i) {
+            while (!q.push(make_bureau(next_in))) {
+                auto b = q.pop();
+                ASSERT_TRUE(b);
+                ASSERT_EQ(b->prog_qty, next_out++);
+            }
+            next_in++;
+        }
+
+        q.flush();
+        while (auto b = q.pop()) ASSERT_EQ(b->prog_qty, next_out++);
+        q.commit();
+        ASSERT_EQ(next_out, next_in);
+    }
+}
+
+TEST(BureauQueue, DamagedEntriesBelowTailCheckpointAreSkipped) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    const auto entry = [](uint64_t pos) { return kBase + BureauQueue::kMetaSize + uint32_t(pos) * uint32_t(sizeof(QueueEntry)); };
+
+    {
+        BureauQueue q(mram, kBase, 64, 4);
+        for (size_t i = 0; i < 24; ++i) q.push(make_bureau(i));
+        q.checkpoint();                                           // tail checkpoint at 24
+        for (size_t i = 24; i < 28; ++i) q.push(make_bureau(i));  // one more batch, past it
+    }
+
+    // Two bad entries below the tail checkpoint, one past it
+    for (uint64_t pos : {5u, 6u, 26u}) emu.memory()[entry(pos) + 8] ^= 0xFF;
+
+    BureauQueue q(mram, kBase, 64, 4);
+    EXPECT_EQ(q.lost(), 2u);
+    EXPECT_EQ(q.tail(), 26u);  // the scan past the checkpoint still stops at damage
+    EXPECT_EQ(q.scanned(), 2u);
+
+    std::vector<size_t> got;
+    while (auto b = q.pop()) got.push_back(b->prog_qty);
+    std::vector<size_t> want;
+    for (size_t i = 0; i < 26; ++i) {
+        if (i != 5 && i != 6) want.push_back(i);
+    }
+    EXPECT_EQ(got, want);
+    EXPECT_EQ(q.head(), 26u);
+}
+
+TEST(BureauQueue, PowerCutDuringFlushKeepsValidPrefix) {
+    std::vector<uint8_t> backing(MR25H40::kSize);
+
+    {
+        MR25H40Emulator emu(backing);
+        MR25H40 mram(emu);
+        BureauQueue q(mram, kBase, 32, 8);
+        for (size_t i = 0; i < 8; ++i) q.push(make_bureau(i));
+    }
+
+    for (size_t cut = 0; cut <= 8 * sizeof(QueueEntry); cut += 7) {
+        std::vector<uint8_t> copy = backing;
+        MR25H40Emulator emu(copy);
+        MR25H40 mram(emu);
+
+        {
+            BureauQueue q(mram, kBase, 32, 8);
+            emu.cut_power_after(cut);
+            for (size_t i = 8; i < 16; ++i) q.push(make_bureau(i));
+            emu.restore_power();
+        }
+
+        BureauQueue q(mram, kBase, 32, 8);
+        EXPECT_EQ(q.tail(), 8 + cut / sizeof(QueueEntry)) << "cut " << cut;
+        for (size_t i = 0; i < q.tail(); ++i) EXPECT_EQ(q.pop()->prog_qty, i);
+    }
+}
+
+TEST(BureauQueue, ForeignRegionIsFormatted) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    std::fill(emu.memory().begin() + kBase, emu.memory().begin() + kBase + BureauQueue::footprint(32), 0x77);
+
+    BureauQueue q(mram, kBase, 32);
+    EXPECT_EQ(q.size(), 0u);
+
+    // A different capacity does not mount this queue
+    q.push(make_bureau(1));
+    q.checkpoint();
+    BureauQueue other(mram, kBase, 16);
+    EXPECT_EQ(other.size(), 0u);
+
+    EXPECT_THROW(BureauQueue(mram, kBase, 0), std::invalid_argument);
+    EXPECT_THROW(BureauQueue(mram, kBase, 8, 9), std::invalid_argument);
+    EXPECT_THROW(BureauQueue(mram, MR25H40::kSize - 64, 8), std::invalid_argument);
+}
+
+TEST(BureauQueue, ProducerAndConsumerThreadsOnGatedBus) {
+    MR25H40Emulator spi;
+    BusGate gate;
+    GatedSpi pbus(spi, gate, BusPriority::Foreground), cbus(spi, gate, BusPriority::Foreground);
+    MR25H40 producer(pbus), consumer(cbus);
+    constexpr size_t kItems = 20000;
+
+    {
+        BureauQueue q(producer, consumer, kBase, 256, 16);
+
+        std::thread prod([&] {
+            for (size_t i = 0; i < kItems; ) {
+                if (q.push(make_bureau(i))) ++i;
+                else std::this_thread::yield();
+            }
+            q.checkpoint();
+        });
+
+        size_t got = 0;
+        bool ordered = true;
+        while (got < kItems) {
+            if (auto b = q.pop()) {
+                ordered = ordered && b->prog_qty == got && b->math_qty == uint32_t(got * 3);
+                ++got;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        prod.join();
+        q.commit();
+        EXPECT_TRUE(ordered);
+    }
+
+    BureauQueue q(producer, kBase, 256, 16);
+    EXPECT_EQ(q.head(), kItems);
+    EXPECT_EQ(q.size(), 0u);
+}
+
+TEST(BureauQueue, ProducerAndConsumerThreadsOnOneDriver) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    constexpr size_t kItems = 5000;
+
+    {
+        BureauQueue q(mram, kBase, 64, 8);
+
+        std::thread prod([&] {
+            for (size_t i = 0; i < kItems; ) {
+                if (q.push(make_bureau(i))) ++i;
+                else std::this_thread::yield();
+            }
+            q.checkpoint();
+        });
+
+        size_t got = 0;
+        bool ordered = true;
+        while (got < kItems) {
+            if (auto b = q.pop()) {
+                ordered = ordered && b->prog_qty == got;
+                ++got;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        prod.join();
+        q.commit();
+        EXPECT_TRUE(ordered);
+    }
+
+    BureauQueue q(mram, kBase, 64, 8);
+    EXPECT_EQ(q.head(), kItems);
+    EXPECT_EQ(q.tail(), kItems);
+    EXPECT_EQ(q.lost(), 0u);
+}
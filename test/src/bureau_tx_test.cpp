@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <stdexcept>
+
+#include "../../include/bureau_tx.h"
+#include "../../include/bureau_store.h"
+#include "../../include/mram_mr25h40.h"
+#include "../mocks/spi_mock.h"
+
+static Bureau make_bureau(size_t prog, uint32_t math) {
+    return Bureau{.prog_qty = prog, .math_qty = math, .head_qty = uint8_t(prog), .salary_sum = float(math)};
+}
+
+static constexpr uint32_t kBase = 0x8000;
+
+TEST(BureauTxStore, CommitIsOneWriteAndAppliesLazily) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    BureauTxStore tx(mram, kBase, 4);
+
+    tx.begin();
+    tx.put(0, make_bureau(1, 10));
+    tx.put(2, make_bureau(2, 20));
+    tx.put(3, make_bureau(3, 30));
+    tx.put(2, make_bureau(4, 40));  // restaged key replaces the earlier put
+
+    const size_t before = spi.transactions;
+    tx.commit();
+    EXPECT_EQ(spi.transactions - before, 2u);  // WREN + WRITE
+    EXPECT_EQ(tx.pending(), 3u);
+    EXPECT_EQ(tx.last_txid(), 1u);
+
+    EXPECT_EQ(tx.read(2).prog_qty, 4u);
+    EXPECT_THROW(tx.read(1), std::runtime_error);
+
+    BureauStore home2(mram, tx.store_base(2));
+    EXPECT_THROW(home2.read(), std::runtime_error);  // not applied yet
+
+    tx.apply();
+    EXPECT_EQ(tx.pending(), 0u);
+    EXPECT_EQ(home2.read().prog_qty, 4u);
+    EXPECT_EQ(BureauStore(mram, tx.store_base(3)).read().math_qty, 30u);
+}
+
+TEST(BureauTxStore, RollbackAndMisuse) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    BureauTxStore tx(mram, kBase, 2);
+
+    EXPECT_THROW(tx.put(0, make_bureau(1, 1)), std::runtime_error);
+    EXPECT_THROW(tx.commit(), std::runtime_error);
+
+    tx.begin();
+    EXPECT_THROW(tx.begin(), std::runtime_error);
+    EXPECT_THROW(tx.put(2, make_bureau(1, 1)), std::out_of_range);
+    tx.put(0, make_bureau(1, 1));
+    tx.rollback();
+    EXPECT_FALSE(tx.in_transaction());
+    EXPECT_THROW(tx.read(0), std::runtime_error);
+
+    BureauTxStore big(mram, kBase, 40);
+    big.begin();
+    for (uint32_t k = 0; k < BureauTxStore::kMaxEntries; ++k) big.put(k, make_bureau(k, k));
+    EXPECT_THROW(big.put(BureauTxStore::kMaxEntries, make_bureau(0, 0)), std::overflow_error);
+
+    EXPECT_THROW(BureauTxStore(mram, MR25H40::kSize - 0x100, 1), std::invalid_argument);
+}
+
+TEST(BureauTxStore, PendingTransactionSurvivesRemount) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+
+    {
+        BureauTxStore tx(mram, kBase, 3);
+        tx.begin();
+        tx.put(0, make_bureau(5, 50));
+        tx.put(1, make_bureau(6, 60));
+        tx.commit();
+    }
+
+    BureauTxStore again(mram, kBase, 3);
+    EXPECT_EQ(again.last_txid(), 1u);
+    EXPECT_EQ(again.pending(), 2u);
+    EXPECT_EQ(again.read(1).prog_qty, 6u);
+
+    again.begin();
+    again.put(2, make_bureau(7, 70));
+    again.commit();  // applies txid 1 first
+    EXPECT_EQ(BureauStore(mram, again.store_base(0)).read().prog_qty, 5u);
+    EXPECT_EQ(again.last_txid(), 2u);
+}
+
+TEST(BureauTxStore, PowerCutDuringCommitIsAllOrNothing) {
+    const uint32_t commit_bytes = sizeof(RedoHeader) + 3 * sizeof(RedoEntry) + sizeof(uint64_t);
+
+    for (uint32_t cut = 0; cut <= commit_bytes; ++cut) {
+        SpiMock spi;
+        MR25H40 mram(spi);
+        BureauTxStore tx(mram, kBase, 3);
+
+        tx.begin();
+        tx.put(0, make_bureau(1, 1));
+        tx.put(1, make_bureau(1, 1));
+        tx.put(2, make_bureau(1, 1));
+        tx.commit();
+        tx.apply();
+
+        tx.begin();
+        tx.put(0, make_bureau(2, 2));
+        tx.put(1, make_bureau(2, 2));
+        tx.put(2, make_bureau(2, 2));
+        spi.write_budget = cut;
+        tx.commit();
+        spi.write_budget = SIZE_MAX;
+
+        BureauTxStore again(mram, kBase, 3);
+        const size_t v = again.read(0).prog_qty;
+        ASSERT_TRUE(v == 1 || v == 2) << "cut " << cut;
+        ASSERT_EQ(again.read(1).prog_qty, v) << "cut " << cut;
+        ASSERT_EQ(again.read(2).prog_qty, v) << "cut " << cut;
+        if (cut == commit_bytes) {
+            ASSERT_EQ(v, 2u);
+        }
+    }
+}
+
+TEST(BureauTxStore, LastTxidSurvivesTornCommit) {
+    const uint32_t commit_bytes = sizeof(RedoHeader) + 2 * sizeof(RedoEntry) + sizeof(uint64_t);
+
+    for (uint32_t cut = 0; cut <= commit_bytes; ++cut) {
+        SpiMock spi;
+        MR25H40 mram(spi);
+        BureauTxStore tx(mram, kBase, 2);
+
+        // txids 1..3: the torn txid 4 lands on the area of txid 2
+        for (size_t n = 1; n <= 3; ++n) {
+            tx.begin();
+            tx.put(0, make_bureau(n, 0));
+            tx.put(1, make_bureau(n, 0));
+            tx.commit();
+        }
+        tx.apply();
+
+        tx.begin();
+        tx.put(0, make_bureau(4, 0));
+        tx.put(1, make_bureau(4, 0));
+        spi.write_budget = cut;
+        tx.commit();
+        spi.write_budget = SIZE_MAX;
+
+        BureauTxStore again(mram, kBase, 2);
+        const uint64_t id = again.last_txid();
+        // Once the first commit word byte lands the rest already matches
+        ASSERT_TRUE(id == 3 || id == 4) << "cut " << cut;
+        if (cut <= commit_bytes - sizeof(uint64_t)) ASSERT_EQ(id, 3u) << "cut " << cut;
+        if (cut == commit_bytes) ASSERT_EQ(id, 4u);
+        ASSERT_EQ(again.read(0).prog_qty, id) << "cut " << cut;
+
+        // The next commit goes on from there
+        again.begin();
+        again.put(1, make_bureau(9, 0));
+        again.commit();
+        ASSERT_EQ(again.last_txid(), id + 1) << "cut " << cut;
+        ASSERT_EQ(BureauTxStore(mram, kBase, 2).last_txid(), id + 1) << "cut " << cut;
+    }
+}
+
+TEST(BureauTxStore, PowerCutDuringApplyReplaysEachRecordOnce) {
+    const uint32_t apply_bytes = 3 * BureauStore::RECORD_SZ;
+
+    for (uint32_t cut = 0; cut <= apply_bytes; ++cut) {
+        SpiMock spi;
+        MR25H40 mram(spi);
+
+        {
+            BureauTxStore tx(mram, kBase, 3);
+            tx.begin();
+            for (uint32_t k = 0; k < 3; ++k) tx.put(k, make_bureau(10 + k, k));
+            tx.commit();
+
+            spi.write_budget = cut;
+            tx.apply();
+            spi.write_budget = SIZE_MAX;
+        }
+
+        BureauTxStore again(mram, kBase, 3);
+        again.apply();
+
+        for (uint32_t k = 0; k < 3; ++k) {
+            BureauStore home(mram, again.store_base(k));
+            ASSERT_EQ(home.read().prog_qty, 10u + k) << "cut " << cut;
+            ASSERT_EQ(home.last_seqno(), 1u) << "cut " << cut;
+            // The summary lands with the record it describes
+            ASSERT_EQ(home.read_summary().count, 1u) << "cut " << cut;
+        }
+    }
+}
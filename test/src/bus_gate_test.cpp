@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../include/bus_gate.h"
+#include "../../include/mram_mr25h40.h"
+#include "../mocks/spi_mock.h"
+
+using namespace std::chrono_literals;
+
+static void wait_for(const std::function<bool()>& cond) {
+    for (int i = 0; i < 2000 && !cond(); ++i) std::this_thread::sleep_for(1ms);
+}
+
+TEST(BusGate, ForegroundOvertakesQueuedBackground) {
+    BusGate gate;
+    std::string order;
+    std::mutex om;
+
+    gate.lock(BusPriority::Background);
+
+    std::thread bg([&] {
+        gate.lock(BusPriority::Background);
+        { std::lock_guard lk(om); order += 'B'; }
+        gate.unlock();
+    });
+    wait_for([&] { return gate.waiting(BusPriority::Background) == 1; });
+
+    std::thread fg([&] {
+        gate.lock(BusPriority::Foreground);
+        { std::lock_guard lk(om); order += 'F'; }
+        gate.unlock();
+    });
+    wait_for([&] { return gate.waiting(BusPriority::Foreground) == 1; });
+
+    gate.unlock();
+    fg.join();
+    bg.join();
+    EXPECT_EQ(order, "FB");
+}
+
+TEST(BusGate, HighestClassFirstFifoWithinClass) {
+    BusGate gate;
+    std::string order;
+    std::mutex om;
+    std::vector<std::thread> ts;
+
+    gate.lock(BusPriority::Background);
+
+    auto enqueue = [&](BusPriority p, char tag) {
+        const uint32_t before = gate.waiting(p);
+        ts.emplace_back([&, p, tag] {
+            gate.lock(p);
+            { std::lock_guard lk(om); order += tag; }
+            gate.unlock();
+        });
+        wait_for([&] { return gate.waiting(p) == before + 1; });
+    };
+
+    enqueue(BusPriority::Background, 'b');
+    enqueue(BusPriority::Foreground, 'f');
+    enqueue(BusPriority::Critical, 'C');
+    enqueue(BusPriority::Foreground, 'g');
+    enqueue(BusPriority::Critical, 'D');
+
+    gate.unlock();
+    for (auto& t : ts) t.join();
+    EXPECT_EQ(order, "CDfgb");
+}
+
+TEST(LatencyHistogram, BucketsAndPercentiles) {
+    LatencyHistogram h;
+    EXPECT_EQ(h.percentile(99), 0u);
+
+    for (uint64_t v = 1; v <= 100; ++v) h.add(v);
+    h.add(10000);
+
+    EXPECT_EQ(h.count(), 101u);
+    EXPECT_EQ(h.max(), 10000u);
+    EXPECT_EQ(h.percentile(50), 63u);     // 51st value sits in [32, 63]
+    EXPECT_EQ(h.percentile(99), 127u);
+    EXPECT_EQ(h.percentile(100), 10000u);
+}
+
+// SpiMock clocked at roughly 64 bytes per microsecond, so a large write
+// really occupies the bus while a reader queues behind it
+struct SlowSpi final : Spi {
+
+    SpiMock& mock;
+    explicit SlowSpi(SpiMock& m) : mock(m) {}
+
+    void transfer(std::span<const uint8_t> tx, std::span<uint8_t> rx) override {
+
+        mock.transfer(tx, rx);
+        const size_t n = std::max(tx.size(), rx.size());
+        if (n >= 1024) std::this_thread::sleep_for(std::chrono::microseconds(n / 64));
+    }
+    void cs_assert() override { mock.cs_assert(); }
+    void cs_deassert() override { mock.cs_deassert(); }
+    void delay_us(uint32_t us) override { mock.delay_us(us); }
+};
+
+// Critical reads against a background writer streaming large blocks: the
+// wait, in bus bytes clocked by others, is bounded by one transfer piece.
+static LatencyHistogram critical_read_waits(size_t max_transfer) {
+    SpiMock mock;
+    SlowSpi spi(mock);
+    BusGate gate;
+    GatedSpi bg_spi(spi, gate, BusPriority::Background);
+    GatedSpi rd_spi(spi, gate, BusPriority::Critical);
+    MR25H40 writer(bg_spi);
+    MR25H40 reader(rd_spi);
+    writer.set_max_transfer(max_transfer);
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> writes{0};
+    std::vector<uint8_t> big(128 * 1024, 0x5A);
+
+    std::thread w([&] {
+        while (!stop) {
+            writer.write(0x10000, big);
+            ++writes;
+        }
+    });
+
+    wait_for([&] { return writes > 0; });
+    gate.reset_stats();
+
+    std::array<uint8_t, 24> buf{};
+    for (int i = 0; i < 50; ++i) {
+        reader.read(0x100, buf);
+        std::this_thread::sleep_for(300us);
+    }
+
+    stop = true;
+    w.join();
+    return gate.wait_bytes(BusPriority::Critical);
+}
+
+TEST(BusScheduler, SplitTransfersBoundCriticalReadWait) {
+    LatencyHistogram split = critical_read_waits(4096);
+    ASSERT_EQ(split.count(), 50u);
+    EXPECT_LE(split.max(), 4096u + 4u) << "p50 " << split.percentile(50) << " p99 " << split.percentile(99);
+
+    LatencyHistogram whole = critical_read_waits(0);
+    ASSERT_EQ(whole.count(), 50u);
+    EXPECT_GT(whole.max(), 4096u + 4u) << "p50 " << whole.percentile(50) << " p99 " << whole.percentile(99);
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+
+#include "../../include/mram_emulator.h"
+#include "../../include/mram_mr25h40.h"
+#include "../../include/bureau_store.h"
+
+// One CS-framed command, returning `rx_len` bytes clocked out after it
+static std::vector<uint8_t> cmd(MR25H40Emulator& emu, std::initializer_list<uint8_t> tx, size_t rx_len = 0) {
+    std::vector<uint8_t> out(tx), rx(rx_len);
+    emu.cs_assert();
+    emu.transfer(out, {});
+    if (rx_len) emu.transfer({}, rx);
+    emu.cs_deassert();
+    return rx;
+}
+
+TEST(Emulator, DriverAndStoreRoundTrip) {
+    MR25H40Emulator emu;
+    BasicMR25H40<MR25H40Emulator> mram(emu);
+
+    std::vector<uint8_t> in(70000);
+    for (size_t i = 0; i < in.size(); ++i) in[i] = uint8_t(i * 7 + 1);
+    mram.write(0x1234, in);
+
+    std::vector<uint8_t> out(in.size());
+    mram.read(0x1234, out);
+    EXPECT_EQ(in, out);
+    EXPECT_EQ(emu.transactions(), 3u);  // WREN, WRITE, READ
+
+    BasicBureauStore<MR25H40Emulator> store(mram);
+    store.write(Bureau{.prog_qty = 9, .math_qty = 8, .head_qty = 7, .salary_sum = 6.5f});
+    EXPECT_EQ(store.read().prog_qty, 9u);
+
+    EXPECT_EQ(mram.erase_all(0xEE), MR25H40::kSize);
+    EXPECT_EQ(emu.memory()[MR25H40::kSize - 1], 0xEE);
+}
+
+TEST(Emulator, WriteNeedsWelAndWelPersists) {
+    MR25H40Emulator emu;
+
+    cmd(emu, {MR25H40::WRITE, 0x00, 0x00, 0x10, 0xAA});
+    EXPECT_EQ(emu.memory()[0x10], 0x00);
+
+    cmd(emu, {MR25H40::WREN});
+    cmd(emu, {MR25H40::WRITE, 0x00, 0x00, 0x10, 0xAA});
+    cmd(emu, {MR25H40::WRITE, 0x00, 0x00, 0x11, 0xBB});
+    EXPECT_EQ(emu.memory()[0x10], 0xAA);
+    EXPECT_EQ(emu.memory()[0x11], 0xBB);
+    EXPECT_EQ(cmd(emu, {MR25H40::RDSR}, 2), (std::vector<uint8_t>{MR25H40::SR_WEL, MR25H40::SR_WEL}));
+
+    cmd(emu, {MR25H40::WRDI});
+    cmd(emu, {MR25H40::WRITE, 0x00, 0x00, 0x10, 0x55});
+    EXPECT_EQ(emu.memory()[0x10], 0xAA);
+}
+
+TEST(Emulator, BlockProtectSkipsProtectedBytes) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    mram.set_block_protect(MR25H40::Protect::UpperQuarter);
+
+    // Starts below 0x60000 and runs into the protected quarter
+    std::vector<uint8_t> data(32, 0x5A);
+    cmd(emu, {MR25H40::WREN});
+    emu.cs_assert();
+    emu.transfer(std::vector<uint8_t>{MR25H40::WRITE, 0x05, 0xFF, 0xF0}, {});
+    emu.transfer(data, {});
+    emu.cs_deassert();
+
+    EXPECT_EQ(emu.memory()[0x5FFFF], 0x5A);
+    EXPECT_EQ(emu.memory()[0x60000], 0x00);
+    EXPECT_EQ(emu.memory()[0x6000F], 0x00);
+}
+
+TEST(Emulator, SrwdWithWpLowLocksStatusRegister) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+
+    mram.write_status(MR25H40::SR_WD | MR25H40::SR_BP1);
+    EXPECT_EQ(mram.read_status() & ~MR25H40::SR_WEL, MR25H40::SR_WD | MR25H40::SR_BP1);
+
+    emu.set_wp(false);
+    mram.write_status(0);
+    EXPECT_EQ(mram.read_status() & ~MR25H40::SR_WEL, MR25H40::SR_WD | MR25H40::SR_BP1);
+
+    emu.set_wp(true);
+    mram.write_status(0);
+    EXPECT_EQ(mram.read_status() & ~MR25H40::SR_WEL, 0u);
+}
+
+TEST(Emulator, ReadAndWriteWrapAtTopOfArray) {
+    MR25H40Emulator emu;
+
+    cmd(emu, {MR25H40::WREN});
+    cmd(emu, {MR25H40::WRITE, 0x07, 0xFF, 0xFE, 1, 2, 3, 4});
+    EXPECT_EQ(emu.memory()[MR25H40::kSize - 1], 2);
+    EXPECT_EQ(emu.memory()[1], 4);
+
+    EXPECT_EQ(cmd(emu, {MR25H40::READ, 0x07, 0xFF, 0xFE}, 4), (std::vector<uint8_t>{1, 2, 3, 4}));
+}
+
+TEST(Emulator, SleepIgnoresAllButWake) {
+    MR25H40Emulator emu;
+
+    cmd(emu, {MR25H40::SLP});
+    EXPECT_TRUE(emu.sleeping());
+    cmd(emu, {MR25H40::WREN});
+    EXPECT_EQ(emu.status(), 0u);
+    EXPECT_EQ(cmd(emu, {MR25H40::READ, 0, 0, 0}, 2), (std::vector<uint8_t>{0xFF, 0xFF}));
+
+    cmd(emu, {MR25H40::WAK});
+    EXPECT_FALSE(emu.sleeping());
+    cmd(emu, {MR25H40::WREN});
+    EXPECT_EQ(emu.status(), MR25H40::SR_WEL);
+}
+
+TEST(Emulator, PowerCutAndExternalBacking) {
+    std::vector<uint8_t> backing(MR25H40::kSize, 0);
+    MR25H40Emulator emu(backing);
+    MR25H40 mram(emu);
+
+    emu.cut_power_after(3);
+    mram.write(0x100, std::vector<uint8_t>{1, 2, 3, 4, 5});
+    emu.restore_power();
+    EXPECT_EQ(std::vector<uint8_t>(backing.begin() + 0x100, backing.begin() + 0x105), (std::vector<uint8_t>{1, 2, 3, 0, 0}));
+
+    std::vector<uint8_t> small(16);
+    EXPECT_THROW(MR25H40Emulator{small}, std::invalid_argument);
+
+    std::array<uint8_t, 1> b{};
+    EXPECT_THROW(emu.transfer(b, {}), std::runtime_error);
+}
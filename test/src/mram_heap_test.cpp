@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "../../include/mram_heap.h"
+#include "../../include/mram_emulator.h"
+#include "../../include/mram_mr25h40.h"
+
+static constexpr uint32_t kBase = 0x10000;
+static constexpr uint32_t kRegion = 0x10000;
+
+TEST(MramHeap, SizeClasses) {
+    EXPECT_EQ(MramHeap::size_class(1), 0u);
+    EXPECT_EQ(MramHeap::size_class(32), 0u);
+    EXPECT_EQ(MramHeap::size_class(33), 1u);
+    EXPECT_EQ(MramHeap::size_class(104), 4u);  // 128
+    EXPECT_EQ(MramHeap::size_class(2048), MramHeap::kClasses.size() - 1);
+    EXPECT_EQ(MramHeap::size_class(2049), MramHeap::kClasses.size());
+}
+
+TEST(MramHeap, AllocCommitsOneByteAndReusesFreedBlock) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    MramHeap heap(mram, kBase, kRegion);
+
+    EXPECT_GT(heap.pages(), 0u);
+    EXPECT_GE(heap.data_base(), kBase + sizeof(HeapHeader));
+
+    const uint32_t a = heap.alloc(100);  // carves a fresh page
+    EXPECT_EQ(heap.block_size(a), 128u);
+
+    // Warm path: WREN + one-byte WRITE of the bitmap
+    size_t before = emu.transactions();
+    const uint32_t b = heap.alloc(128);
+    EXPECT_EQ(emu.transactions() - before, 2u);
+    EXPECT_NE(a, b);
+    EXPECT_TRUE(heap.allocated(b));
+    EXPECT_EQ(heap.used_blocks(), 2u);
+
+    // Free clears the block, then its bit
+    std::vector<uint8_t> junk(128, 0xAB);
+    mram.write(b, junk);
+    heap.free(b);
+    EXPECT_FALSE(heap.allocated(b));
+    EXPECT_TRUE(std::all_of(emu.memory().begin() + b, emu.memory().begin() + b + 128, [](uint8_t v) { return v == 0; }));
+
+    EXPECT_EQ(heap.alloc(120), b);  // LIFO free list
+    EXPECT_THROW(heap.free(b + 1), std::invalid_argument);
+    EXPECT_THROW(heap.free(kBase), std::invalid_argument);
+    heap.free(b);
+    EXPECT_THROW(heap.free(b), std::invalid_argument);
+    EXPECT_THROW(heap.alloc(4096), std::invalid_argument);
+}
+
+TEST(MramHeap, ClassesUseSeparatePages) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    MramHeap heap(mram, kBase, kRegion);
+
+    const uint32_t pages = heap.free_pages();
+    const uint32_t small = heap.alloc(32);
+    const uint32_t big = heap.alloc(2048);
+    EXPECT_EQ(heap.free_pages(), pages - 2);
+    EXPECT_NE(small / MramHeap::kPageSize, big / MramHeap::kPageSize);
+
+    // A page holds kPageSize / class blocks before the next one is taken
+    for (uint32_t i = 1; i < MramHeap::kPageSize / 32; ++i) heap.alloc(32);
+    EXPECT_EQ(heap.free_pages(), pages - 2);
+    heap.alloc(32);
+    EXPECT_EQ(heap.free_pages(), pages - 3);
+}
+
+TEST(MramHeap, OwnersUseSeparatePages) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    uint32_t raw = 0, owned = 0;
+
+    {
+        MramHeap heap(mram, kBase, kRegion);
+        raw = heap.alloc(64);
+        owned = heap.alloc(64, 5);
+        EXPECT_NE(raw / MramHeap::kPageSize, owned / MramHeap::kPageSize);
+        heap.free(owned);
+    }
+
+    MramHeap heap(mram, kBase, kRegion);
+    EXPECT_EQ(heap.owner(raw), MramHeap::kNoOwner);
+    EXPECT_EQ(heap.owner(owned), 5u);
+    EXPECT_EQ(heap.alloc(64, 5), owned);
+    EXPECT_NE(heap.alloc(64), owned);
+}
+
+TEST(MramHeap, StatePersistsAcrossMount) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    std::vector<uint32_t> live;
+
+    {
+        MramHeap heap(mram, kBase, kRegion);
+        for (int i = 0; i < 10; ++i) live.push_back(heap.alloc(64));
+        live.push_back(heap.alloc(500));
+        heap.free(live[3]);
+        live.erase(live.begin() + 3);
+    }
+
+    MramHeap heap(mram, kBase, kRegion);
+    EXPECT_EQ(heap.used_blocks(), live.size());
+
+    std::vector<uint32_t> seen;
+    heap.for_each_allocated([&](uint32_t addr, uint32_t bs) {
+        seen.push_back(addr);
+        EXPECT_EQ(bs, heap.block_size(addr));
+    });
+    std::sort(live.begin(), live.end());
+    EXPECT_EQ(seen, live);
+
+    // The freed block is handed out again, not a fresh one
+    const uint32_t again = heap.alloc(64);
+    EXPECT_FALSE(std::binary_search(live.begin(), live.end(), again));
+    EXPECT_LT(again, live.back());
+}
+
+TEST(MramHeap, OutOfSpaceAndBadRegion) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    MramHeap heap(mram, kBase, 3 * MramHeap::kPageSize);
+
+    const uint32_t n = heap.pages() * (MramHeap::kPageSize / 2048);
+    for (uint32_t i = 0; i < n; ++i) heap.alloc(2048);
+    EXPECT_THROW(heap.alloc(2048), std::overflow_error);
+    EXPECT_THROW(heap.alloc(32), std::overflow_error);
+
+    EXPECT_THROW(MramHeap(mram, kBase, 100), std::invalid_argument);
+    EXPECT_THROW(MramHeap(mram, MR25H40::kSize - 0x1000, 0x2000), std::invalid_argument);
+}
+
+TEST(MramHeap, ForeignHeaderIsFormatted) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    std::fill(emu.memory().begin() + kBase, emu.memory().begin() + kBase + kRegion, 0x5A);
+
+    MramHeap heap(mram, kBase, kRegion);
+    EXPECT_EQ(heap.used_blocks(), 0u);
+    EXPECT_EQ(heap.free_pages(), heap.pages());
+
+    // Fresh pages read as zeros whatever was there before
+    const uint32_t a = heap.alloc(256);
+    EXPECT_TRUE(std::all_of(emu.memory().begin() + a, emu.memory().begin() + a + 256, [](uint8_t v) { return v == 0; }));
+}
+
+TEST(MramHeap, ErrorCodesOnConcreteBackend) {
+    MR25H40Emulator emu;
+    BasicMR25H40<MR25H40Emulator> mram(emu);
+
+    BasicMramHeap<MR25H40Emulator> bad(mram, kBase, 100, std::nothrow);
+    EXPECT_EQ(bad.pages(), 0u);
+    EXPECT_EQ(bad.try_mount().error(), MramErrc::BadArgument);
+
+    BasicMramHeap<MR25H40Emulator> heap(mram, kBase, kRegion, std::nothrow);
+    ASSERT_TRUE(heap.try_mount());
+    EXPECT_EQ(heap.try_alloc(4096).error(), MramErrc::BadArgument);
+    EXPECT_FALSE(heap.allocated(kBase));
+    EXPECT_EQ(heap.try_free(heap.data_base()).error(), MramErrc::BadArgument);
+
+    const auto a = heap.try_alloc(64);
+    ASSERT_TRUE(a);
+    EXPECT_EQ(heap.try_block_size(*a).value(), 64u);
+    EXPECT_EQ(heap.try_owner(*a).value(), BasicMramHeap<MR25H40Emulator>::kNoOwner);
+    EXPECT_EQ(heap.try_owner(*a + 1).error(), MramErrc::BadArgument);
+    ASSERT_TRUE(heap.try_free(*a));
+    EXPECT_EQ(heap.try_free(*a).error(), MramErrc::BadArgument);
+
+    // A region under block protection cannot be formatted: the fills fall short
+    mram.set_block_protect(MR25H40::Protect::UpperQuarter);
+    BasicMramHeap<MR25H40Emulator> locked(mram, MR25H40::kSize - kRegion, kRegion, std::nothrow);
+    EXPECT_EQ(locked.try_mount().error(), MramErrc::OutOfRange);
+}
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "../../include/mram_image.h"
+#include "../../include/bureau_store.h"
+#include "../../include/mram_emulator.h"
+#include "../mocks/spi_mock.h"
+#include "../mocks/spi_mock_p.h"
+
+static std::string tmp_image(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static Bureau make_bureau(size_t prog) {
+    return Bureau{.prog_qty = prog, .math_qty = uint32_t(prog * 2), .head_qty = 1, .salary_sum = 1.5f};
+}
+
+TEST(MramImage, DumpIsOneStreamingReadAndLoadRestores) {
+    const std::string path = tmp_image("mram_image_roundtrip.img");
+
+    SpiMock src;
+    MR25H40 a(src);
+    BureauStore store(a);
+    for (size_t i = 1; i <= 50; ++i) store.write(make_bureau(i));
+    a.fill(0x60000, 0x100, 0xA5);
+    a.set_block_protect(MR25H40::Protect::UpperQuarter);
+
+    const size_t before = src.transactions;
+    MramImage::dump(a, path);
+    EXPECT_EQ(src.transactions - before, 2u);  // RDSR + one READ of the whole array
+
+    SpiMockP dst;
+    MR25H40 b(dst);
+    MramImage::load(b, path);
+    EXPECT_EQ(b.read_status() & (MR25H40::SR_BP0 | MR25H40::SR_BP1), MR25H40::SR_BP0);
+
+    BureauStore restored(b);
+    EXPECT_EQ(restored.read().prog_qty, 50u);
+    EXPECT_EQ(restored.read_summary().count, 50u);
+
+    std::array<uint8_t, 4> tail{};
+    b.read(0x60000 + 0xFC, tail);
+    EXPECT_EQ(tail, (std::array<uint8_t, 4>{0xA5, 0xA5, 0xA5, 0xA5}));
+
+    std::remove(path.c_str());
+}
+
+TEST(MramImage, LoadIntoBackendMemory) {
+    const std::string path = tmp_image("mram_image_direct.img");
+
+    SpiMock src;
+    MR25H40 a(src);
+    BureauStore(a).write(make_bureau(7));
+    MramImage::dump(a, path);
+
+    SpiMock dst;
+    dst.sr = MramImage::load_into(dst.mem, path);
+    EXPECT_EQ(dst.mem, src.mem);
+
+    MR25H40 b(dst);
+    EXPECT_EQ(BureauStore(b).read().prog_qty, 7u);
+
+    std::remove(path.c_str());
+}
+
+TEST(MramImage, RejectsDamagedImagesBeforeWriting) {
+    const std::string path = tmp_image("mram_image_bad.img");
+
+    SpiMock src;
+    MR25H40 a(src);
+    BureauStore(a).write(make_bureau(3));
+    MramImage::dump(a, path);
+
+    {
+        std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(sizeof(ImageHeader) + 30);
+        f.put(char(0x7E));
+    }
+
+    SpiMock dst;
+    MR25H40 b(dst);
+    EXPECT_THROW(MramImage::load(b, path), std::runtime_error);
+    EXPECT_EQ(dst.transactions, 0u);
+
+    {
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+        f << "short";
+    }
+    EXPECT_THROW(MramImage::load(b, path), std::runtime_error);
+    EXPECT_THROW(MramImage::load(b, tmp_image("mram_image_missing.img")), std::runtime_error);
+
+    std::remove(path.c_str());
+}
+
+TEST(MramImage, LoadFailsLoudlyWhenDeviceDoesNotTakeIt) {
+    const std::string path = tmp_image("mram_image_locked.img");
+
+    SpiMock src;
+    MR25H40 a(src);
+    BureauStore(a).write(make_bureau(9));
+    MramImage::dump(a, path);
+
+    // SRWD with WP low: the WRSR clearing BP is ignored
+    MR25H40Emulator emu;
+    MR25H40 locked(emu);
+    locked.set_block_protect(MR25H40::Protect::All, true);
+    EXPECT_THROW(MramImage::load(locked, path), std::runtime_error);
+    EXPECT_FALSE(BureauStore(locked).try_read());
+
+    emu.set_wp(true);
+    MramImage::load(locked, path);
+    EXPECT_EQ(BureauStore(locked).read().prog_qty, 9u);
+
+    // Writes that never reach the array are caught by the read-back
+    SpiMock dst;
+    MR25H40 b(dst);
+    dst.write_budget = 100;
+    EXPECT_THROW(MramImage::load(b, path), std::runtime_error);
+
+    std::remove(path.c_str());
+}
@@ -3,9 +3,12 @@
 #include <array>
 #include <cstdint>
 #include <span>
+#include <set>
+#include <stdexcept>
 
 #include "../../include/mram_mr25h40.h"
 #include "../mocks/spi_mock.h"   // non-persistent mock
+#include "../mocks/spi_mock_p.h" // mock with block protection
 
 // --- MR25H40 driver tests that match the actual API (write/read, read_status returning uint8_t) ---
 
@@ -88,3 +91,236 @@ TEST(MRAM_Protection, SRWDBitSetOnHwLock) {
     uint8_t sr = mram.read_status();
     EXPECT_NE((sr & MR25H40::SR_WD), 0u) << "SRWD bit must be set after hw-locked protection";
 }
+
+TEST(MRAM_ReadStream, DeliversChunksInOrderInOneTransaction) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+
+    const uint32_t addr = 0x1234;
+    std::vector<uint8_t> in(10000);
+    for (size_t i = 0; i < in.size(); ++i) in[i] = static_cast<uint8_t>((i * 13) ^ (i >> 8));
+    mram.write(addr, std::span<const uint8_t>(in.data(), in.size()));
+
+    std::vector<uint8_t> out;
+    std::set<const uint8_t*> buffers;
+    uint32_t expect_addr = addr;
+    const size_t before = spi.transactions;
+
+    mram.read_stream(addr, in.size(), 768, [&](uint32_t a, std::span<const uint8_t> d) {
+        EXPECT_EQ(a, expect_addr);
+        EXPECT_LE(d.size(), 768u);
+        expect_addr += uint32_t(d.size());
+        buffers.insert(d.data());
+        out.insert(out.end(), d.begin(), d.end());
+    });
+
+    EXPECT_EQ(out, in);
+    EXPECT_EQ(spi.transactions - before, 1u);
+    EXPECT_LE(buffers.size(), 2u);
+}
+
+TEST(MRAM_ReadStream, CallbackErrorPropagatesAndStopsStream) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+
+    size_t calls = 0;
+    EXPECT_THROW(mram.read_stream(0, 64 * 1024, 256, [&](uint32_t, std::span<const uint8_t>) {
+        if (++calls == 3) throw std::runtime_error("consumer failed");
+    }, 3), std::runtime_error);
+    EXPECT_EQ(calls, 3u);
+    EXPECT_FALSE(spi.cs_low);
+}
+
+TEST(MRAM_ReadStream, RejectsBadArguments) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    auto noop = [](uint32_t, std::span<const uint8_t>) {};
+
+    EXPECT_THROW(mram.read_stream(MR25H40::kSize - 10, 100, 16, noop), std::out_of_range);
+    EXPECT_THROW(mram.read_stream(0, 100, 0, noop), std::invalid_argument);
+    EXPECT_THROW(mram.read_stream(0, 100, 16, noop, 1), std::invalid_argument);
+}
+
+TEST(MRAM_Fill, FillsRangeInOneWriteTransaction) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+
+    std::vector<uint8_t> pre(2048, 0x11);
+    mram.write(0x800, std::span<const uint8_t>(pre.data(), pre.size()));
+
+    const size_t before = spi.transactions;
+    EXPECT_EQ(mram.fill(0x900, 1000, 0xA5), 1000u);
+    EXPECT_EQ(spi.transactions - before, 3u); // RDSR, WREN, WRITE
+
+    std::vector<uint8_t> out(2048);
+    mram.read(0x800, std::span<uint8_t>(out.data(), out.size()));
+    for (size_t i = 0; i < out.size(); ++i) {
+        const bool inside = i >= 0x100 && i < 0x100 + 1000;
+        ASSERT_EQ(out[i], inside ? 0xA5 : 0x11) << "offset " << i;
+    }
+}
+
+TEST(MRAM_Fill, EraseAllSkipsProtectedUpperQuarter) {
+    SpiMockP spi;
+    MR25H40 mram(spi);
+
+    std::array<uint8_t, 4> marks{1, 2, 3, 4};
+    mram.write(0x100, marks);
+    mram.write(0x70000, marks);
+    mram.set_block_protect(MR25H40::Protect::UpperQuarter);
+
+    EXPECT_EQ(mram.erase_all(0xEE), MR25H40::kSize - MR25H40::kSize / 4);
+
+    std::array<uint8_t, 4> lo{}, hi{}, edge{};
+    mram.read(0x100, lo);
+    mram.read(0x70000, hi);
+    mram.read(0x5FFFE, edge);
+    EXPECT_EQ(lo, (std::array<uint8_t, 4>{0xEE, 0xEE, 0xEE, 0xEE}));
+    EXPECT_EQ(hi, marks);
+    EXPECT_EQ(edge, (std::array<uint8_t, 4>{0xEE, 0xEE, 0, 0}));
+
+    mram.set_block_protect(MR25H40::Protect::All);
+    EXPECT_EQ(mram.fill(0, 16, 0x00), 0u);
+    EXPECT_THROW(mram.fill(MR25H40::kSize - 4, 8, 0), std::out_of_range);
+}
+
+// --- Devirtualized driver over a concrete backend ---
+
+static_assert(SpiBackend<SpiMock>);
+static_assert(!SpiBackend<int>);
+
+TEST(MRAM_Template, ConcreteBackendRoundTrip) {
+    SpiMock spi;
+    BasicMR25H40<SpiMock> mram(spi);
+
+    std::array<uint8_t, 16> in{};
+    for (size_t i = 0; i < in.size(); ++i) in[i] = uint8_t(200 - i);
+    mram.write(0x3000, in);
+
+    std::array<uint8_t, 16> out{};
+    mram.read(0x3000, out);
+    EXPECT_EQ(in, out);
+
+    mram.write_enable();
+    EXPECT_NE(mram.read_status() & MR25H40::SR_WEL, 0u);
+    EXPECT_THROW(mram.read(MR25H40::kSize, out), std::out_of_range);
+}
+
+TEST(MRAM_Split, MaxTransferSplitsIntoTransactions) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    mram.set_max_transfer(1000);
+
+    std::vector<uint8_t> in(4500);
+    for (size_t i = 0; i < in.size(); ++i) in[i] = uint8_t(i * 31);
+
+    size_t before = spi.transactions;
+    mram.write(0x777, std::span<const uint8_t>(in.data(), in.size()));
+    EXPECT_EQ(spi.transactions - before, 10u);  // 5 x (WREN + WRITE)
+
+    std::vector<uint8_t> out(in.size());
+    before = spi.transactions;
+    mram.read(0x777, std::span<uint8_t>(out.data(), out.size()));
+    EXPECT_EQ(spi.transactions - before, 5u);
+    EXPECT_EQ(in, out);
+
+    before = spi.transactions;
+    EXPECT_EQ(mram.fill(0x777, 2500, 0x3C), 2500u);
+    EXPECT_EQ(spi.transactions - before, 1u + 6u);  // RDSR + 3 x (WREN + WRITE)
+    mram.read(0x777, std::span<uint8_t>(out.data(), out.size()));
+    for (size_t i = 0; i < out.size(); ++i) ASSERT_EQ(out[i], i < 2500 ? 0x3C : in[i]) << i;
+}
+
+// Scattered small fields, as read by a poller
+static std::vector<uint8_t> patterned_mem(SpiMock& spi) {
+    for (size_t i = 0; i < spi.mem.size(); ++i) spi.mem[i] = uint8_t(i * 13 + (i >> 8));
+    return spi.mem;
+}
+
+TEST(MRAM_ReadMany, CoalescesNearbyRangesAndScatters) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    const auto ref = patterned_mem(spi);
+
+    // Unsorted; two overlapping, one duplicate, one far away
+    std::vector<std::vector<uint8_t>> bufs{std::vector<uint8_t>(4), std::vector<uint8_t>(8), std::vector<uint8_t>(6),
+                                           std::vector<uint8_t>(4), std::vector<uint8_t>(16), std::vector<uint8_t>(3)};
+    const std::vector<uint32_t> addrs{0x114, 0x100, 0x104, 0x114, 0x40000, 0x10A};
+    std::vector<ReadRequest> reqs;
+    for (size_t i = 0; i < bufs.size(); ++i) reqs.push_back({addrs[i], bufs[i]});
+
+    const size_t before = spi.transactions;
+    EXPECT_EQ(mram.read_many(reqs), 2u);
+    EXPECT_EQ(spi.transactions - before, 2u);  // vs 6 single reads
+
+    for (size_t i = 0; i < bufs.size(); ++i)
+        for (size_t j = 0; j < bufs[i].size(); ++j) ASSERT_EQ(bufs[i][j], ref[addrs[i] + j]) << i << ":" << j;
+}
+
+TEST(MRAM_ReadMany, GapThresholdDecidesMerging) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    const auto ref = patterned_mem(spi);
+
+    // 24 four-byte headers 16 bytes apart (12-byte gaps)
+    std::vector<std::array<uint8_t, 4>> bufs(24);
+    std::vector<ReadRequest> reqs;
+    for (size_t i = 0; i < bufs.size(); ++i) reqs.push_back({uint32_t(0x2000 + i * 16), bufs[i]});
+
+    mram.set_coalesce_gap(8);
+    EXPECT_EQ(mram.read_many(reqs), 24u);
+
+    mram.set_coalesce_gap(12);
+    size_t before = spi.transactions;
+    EXPECT_EQ(mram.read_many(reqs), 1u);
+    EXPECT_EQ(spi.transactions - before, 1u);
+    for (size_t i = 0; i < bufs.size(); ++i)
+        for (size_t j = 0; j < 4; ++j) ASSERT_EQ(bufs[i][j], ref[0x2000 + i * 16 + j]);
+
+    // Merged READs are capped by max_transfer: 6 headers (16*5+4 bytes) per READ
+    mram.set_max_transfer(96);
+    before = spi.transactions;
+    EXPECT_EQ(mram.read_many(reqs), 4u);
+    EXPECT_EQ(spi.transactions - before, 4u);
+}
+
+TEST(MRAM_ReadMany, AscendingRunContinuesAcrossGroups) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    const auto ref = patterned_mem(spi);
+
+    // Three full sort groups and a bit, back to back
+    const size_t n = 3 * MR25H40::kReadManyGroup + 6;
+    std::vector<std::array<uint8_t, 4>> bufs(n);
+    std::vector<ReadRequest> reqs;
+    for (size_t i = 0; i < n; ++i) reqs.push_back({uint32_t(0x3000 + i * 4), bufs[i]});
+
+    size_t before = spi.transactions;
+    EXPECT_EQ(mram.read_many(reqs), 1u);
+    EXPECT_EQ(spi.transactions - before, 1u);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < 4; ++j) ASSERT_EQ(bufs[i][j], ref[0x3000 + i * 4 + j]) << i;
+
+    // max_transfer still caps the carried READ: 64 requests fill 256 bytes
+    mram.set_max_transfer(256);
+    EXPECT_EQ(mram.read_many(reqs), 4u);
+    mram.set_max_transfer(0);
+
+    // The next group starting below the open READ cannot continue it
+    reqs[MR25H40::kReadManyGroup].addr = reqs[MR25H40::kReadManyGroup - 1].addr;
+    std::fill(bufs.begin(), bufs.end(), std::array<uint8_t, 4>{});
+    EXPECT_EQ(mram.read_many(reqs), 2u);
+    EXPECT_EQ(bufs[MR25H40::kReadManyGroup], bufs[MR25H40::kReadManyGroup - 1]);
+    for (size_t i = MR25H40::kReadManyGroup + 1; i < n; ++i) ASSERT_EQ(bufs[i][0], ref[0x3000 + i * 4]) << i;
+}
+
+TEST(MRAM_ReadMany, RejectsOutOfRangeBeforeAnyRead) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    std::array<uint8_t, 4> a{}, b{};
+    std::array<ReadRequest, 2> reqs{ReadRequest{0x10, a}, ReadRequest{MR25H40::kSize - 2, b}};
+
+    EXPECT_THROW(mram.read_many(reqs), std::out_of_range);
+    EXPECT_EQ(spi.transactions, 0u);
+    EXPECT_EQ(mram.read_many({}), 0u);
+}
@@ -0,0 +1,352 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../include/record_store.h"
+#include "../../include/mram_heap.h"
+#include "../../include/mram_emulator.h"
+#include "../../include/mram_mr25h40.h"
+#include "../../include/bureau_store.h"
+
+static Bureau make_bureau(size_t prog, uint32_t math) {
+    return Bureau{.prog_qty = prog, .math_qty = math, .head_qty = uint8_t(prog), .salary_sum = float(math)};
+}
+
+// Variable-length value: raw bytes of a string up to 200 chars
+struct NoteCodec {
+    static constexpr uint16_t kTag = 7;
+    static constexpr size_t kMaxSize = 200;
+
+    static Result<size_t> encode(const std::string& s, std::span<uint8_t> out) {
+        if (s.size() > out.size()) return Unexpected{MramErrc::Overflow};
+        std::memcpy(out.data(), s.data(), s.size());
+        return s.size();
+    }
+
+    static Result<std::string> decode(std::span<const uint8_t> in) {
+        return std::string(in.begin(), in.end());
+    }
+};
+
+using Bureaus = RecordStore<Bureau, BureauRecordCodec>;
+using Notes = RecordStore<std::string, NoteCodec>;
+
+static constexpr uint32_t kBase = 0x20000;
+static constexpr uint32_t kRegion = 0x10000;
+
+TEST(RecordStore, CreateUpdateReadErase) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    MramHeap heap(mram, kBase, kRegion);
+    Bureaus rs(mram, heap);
+
+    const auto a = rs.create(make_bureau(1, 10));
+    const auto b = rs.create(make_bureau(2, 20));
+    EXPECT_EQ(rs.size(), 2u);
+    EXPECT_EQ(rs.read(a).prog_qty, 1u);
+
+    // An update is WREN + one WRITE
+    const size_t before = emu.transactions();
+    rs.update(a, make_bureau(3, 30));
+    EXPECT_EQ(emu.transactions() - before, 2u);
+    EXPECT_EQ(rs.read(a).math_qty, 30u);
+    EXPECT_EQ(rs.seqno(a), 2u);
+
+    rs.erase(b);
+    EXPECT_FALSE(rs.contains(b));
+    EXPECT_FALSE(heap.allocated(b));
+    EXPECT_THROW(rs.read(b), std::invalid_argument);
+    EXPECT_THROW(rs.update(b, make_bureau(0, 0)), std::invalid_argument);
+    EXPECT_EQ(rs.ids(), std::vector<Bureaus::Id>{a});
+}
+
+TEST(RecordStore, DenserThanFixedBureauStore) {
+    // Two 52-byte slots fit the 128-byte class; BureauStore takes a fixed 0x200
+    EXPECT_EQ(Bureaus::kBlockSize, 128u);
+    EXPECT_EQ(BureauStore::STORE_SZ / Bureaus::kBlockSize, 4u);
+
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    MramHeap heap(mram, kBase, kRegion);
+    Bureaus rs(mram, heap);
+
+    for (size_t i = 0; i < heap.pages() * (MramHeap::kPageSize / Bureaus::kBlockSize); ++i) rs.create(make_bureau(i, 0));
+    EXPECT_THROW(rs.create(make_bureau(0, 0)), std::overflow_error);
+    EXPECT_GT(rs.size(), kRegion / BureauStore::STORE_SZ * 3);
+}
+
+TEST(RecordStore, TypesShareHeapAndSurviveRemount) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    Bureaus::Id bid = 0;
+    Notes::Id n1 = 0, n2 = 0;
+
+    {
+        MramHeap heap(mram, kBase, kRegion);
+        Bureaus bureaus(mram, heap);
+        Notes notes(mram, heap);
+
+        bid = bureaus.create(make_bureau(5, 50));
+        n1 = notes.create("short");
+        n2 = notes.create(std::string(180, 'x'));
+        notes.update(n1, "a somewhat longer note");
+        notes.update(n1, "");
+        bureaus.update(bid, make_bureau(6, 60));
+    }
+
+    MramHeap heap(mram, kBase, kRegion);
+    Notes notes(mram, heap);
+    Bureaus bureaus(mram, heap);
+
+    EXPECT_EQ(notes.size(), 2u);
+    EXPECT_EQ(bureaus.size(), 1u);
+    EXPECT_EQ(notes.read(n1), "");
+    EXPECT_EQ(notes.seqno(n1), 3u);
+    EXPECT_EQ(notes.read(n2), std::string(180, 'x'));
+    EXPECT_EQ(bureaus.read(bid).prog_qty, 6u);
+    EXPECT_EQ(notes.reclaimed() + bureaus.reclaimed(), 0u);
+
+    EXPECT_THROW(notes.create(std::string(201, 'y')), std::overflow_error);
+    EXPECT_EQ(heap.used_blocks(), 3u);  // no block taken
+}
+
+TEST(RecordStore, PowerCutUpdateKeepsOldOrNewValue) {
+    std::vector<uint8_t> backing(MR25H40::kSize);
+    Bureaus::Id id = 0;
+
+    {
+        MR25H40Emulator emu(backing);
+        MR25H40 mram(emu);
+        MramHeap heap(mram, kBase, kRegion);
+        Bureaus rs(mram, heap);
+        id = rs.create(make_bureau(1, 1));
+        rs.update(id, make_bureau(2, 2));
+    }
+
+    for (size_t cut = 0; cut <= Bureaus::kSlotSize; ++cut) {
+        std::vector<uint8_t> copy = backing;
+        MR25H40Emulator emu(copy);
+        MR25H40 mram(emu);
+
+        {
+            MramHeap heap(mram, kBase, kRegion);
+            Bureaus rs(mram, heap);
+            emu.cut_power_after(cut);
+            rs.update(id, make_bureau(3, 3));
+            emu.restore_power();
+        }
+
+        MramHeap heap(mram, kBase, kRegion);
+        Bureaus rs(mram, heap);
+        const size_t prog = rs.read(id).prog_qty;
+        EXPECT_TRUE(prog == 3 || (prog == 2 && cut < Bureaus::kSlotSize)) << "cut " << cut << " prog " << prog;
+    }
+}
+
+TEST(RecordStore, PowerCutEraseNeverResurrectsOlderValue) {
+    // Newest value in slot B (one update), then in slot A (two)
+    for (int updates : {1, 2}) {
+        std::vector<uint8_t> backing(MR25H40::kSize);
+        Bureaus::Id id = 0;
+
+        {
+            MR25H40Emulator emu(backing);
+            MR25H40 mram(emu);
+            MramHeap heap(mram, kBase, kRegion);
+            Bureaus rs(mram, heap);
+            id = rs.create(make_bureau(1, 1));
+            for (int u = 1; u <= updates; ++u) rs.update(id, make_bureau(1 + u, 1));
+        }
+
+        // Both headers, the block fill, then the bitmap byte
+        const size_t total = 2 * sizeof(RecordHeader) + Bureaus::kBlockSize + 1;
+        for (size_t cut = 0; cut <= total; ++cut) {
+            std::vector<uint8_t> copy = backing;
+            MR25H40Emulator emu(copy);
+            MR25H40 mram(emu);
+
+            {
+                MramHeap heap(mram, kBase, kRegion);
+                Bureaus rs(mram, heap);
+                emu.cut_power_after(cut);
+                rs.erase(id);
+                emu.restore_power();
+            }
+
+            MramHeap heap(mram, kBase, kRegion);
+            Bureaus rs(mram, heap);
+            ASSERT_TRUE(rs.corrupt().empty()) << "updates " << updates << " cut " << cut;
+            if (rs.contains(id)) {
+                EXPECT_EQ(rs.read(id).prog_qty, size_t(1 + updates)) << "updates " << updates << " cut " << cut;
+            } else {
+                EXPECT_FALSE(heap.allocated(id)) << "updates " << updates << " cut " << cut;
+                EXPECT_GT(cut, sizeof(RecordHeader));
+            }
+        }
+    }
+}
+
+TEST(RecordStore, TornCreateIsReclaimedOnMount) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    Bureaus::Id keep = 0;
+
+    {
+        MramHeap heap(mram, kBase, kRegion);
+        Bureaus rs(mram, heap);
+        keep = rs.create(make_bureau(1, 1));
+        emu.cut_power_after(10);
+        rs.create(make_bureau(2, 2));
+        emu.restore_power();
+        EXPECT_EQ(heap.used_blocks(), 2u);
+    }
+
+    MramHeap heap(mram, kBase, kRegion);
+    Bureaus rs(mram, heap);
+    EXPECT_EQ(rs.reclaimed(), 1u);
+    EXPECT_TRUE(rs.corrupt().empty());
+    EXPECT_EQ(rs.ids(), std::vector<Bureaus::Id>{keep});
+    EXPECT_EQ(heap.used_blocks(), 1u);
+
+    // Whatever byte the cut hits, the torn block is told from a damaged one
+    for (size_t cut = 0; cut < Bureaus::kSlotSize; ++cut) {
+        Bureaus fresh(mram, heap);
+        emu.cut_power_after(cut);
+        fresh.create(make_bureau(2, 2));
+        emu.restore_power();
+
+        Bureaus again(mram, heap);
+        ASSERT_TRUE(again.corrupt().empty()) << "cut " << cut;
+        ASSERT_EQ(again.size() + again.reclaimed(), 2u) << "cut " << cut;
+        for (auto id : again.ids()) {
+            if (id != keep) again.erase(id);
+        }
+    }
+}
+
+TEST(RecordStore, RawHeapBlocksOfTheSameClassAreLeftAlone) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    uint32_t blank = 0, junk = 0;
+    Bureaus::Id id = 0;
+
+    {
+        MramHeap heap(mram, kBase, kRegion);
+        Bureaus rs(mram, heap);
+        id = rs.create(make_bureau(1, 1));
+
+        // Same 128-byte class, one left zero like a torn create, one with data
+        blank = heap.alloc(100);
+        junk = heap.alloc(100);
+        std::vector<uint8_t> data(128, 0x3C);
+        mram.write(junk, data);
+        EXPECT_EQ(heap.block_size(blank), Bureaus::kBlockSize);
+        EXPECT_NE(blank / MramHeap::kPageSize, id / MramHeap::kPageSize);
+    }
+
+    MramHeap heap(mram, kBase, kRegion);
+    Bureaus rs(mram, heap);
+    EXPECT_EQ(rs.reclaimed(), 0u);
+    EXPECT_TRUE(rs.corrupt().empty());
+    EXPECT_EQ(rs.ids(), std::vector<Bureaus::Id>{id});
+    EXPECT_TRUE(heap.allocated(blank));
+    EXPECT_TRUE(heap.allocated(junk));
+    EXPECT_EQ(emu.memory()[junk + 127], 0x3C);
+}
+
+TEST(RecordStore, CorruptBlockIsReportedNotFreed) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    Bureaus::Id id = 0;
+
+    {
+        MramHeap heap(mram, kBase, kRegion);
+        Bureaus rs(mram, heap);
+        id = rs.create(make_bureau(1, 1));
+    }
+
+    // A complete record with a flipped bit is not a torn create
+    emu.memory()[id + sizeof(RecordHeader) + 2] ^= 0x10;
+
+    MramHeap heap(mram, kBase, kRegion);
+    Bureaus rs(mram, heap);
+    EXPECT_EQ(rs.reclaimed(), 0u);
+    EXPECT_EQ(rs.corrupt(), std::vector<Bureaus::Id>{id});
+    EXPECT_TRUE(rs.ids().empty());
+    EXPECT_TRUE(heap.allocated(id));
+
+    rs.erase(id);
+    EXPECT_TRUE(rs.corrupt().empty());
+    EXPECT_FALSE(heap.allocated(id));
+}
+
+TEST(RecordStore, DamagedSlotAIsNotMistakenForTornCreate) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    Bureaus::Id seq = 0, commit = 0, tail = 0;
+
+    {
+        MramHeap heap(mram, kBase, kRegion);
+        Bureaus rs(mram, heap);
+        seq = rs.create(make_bureau(1, 1));
+        commit = rs.create(make_bureau(2, 2));
+        tail = rs.create(make_bureau(3, 3));
+    }
+
+    // Commit word cleared on each; then a seqno no create writes, and junk
+    // past the record where a create leaves zeros
+    const size_t commit_off = sizeof(RecordHeader) + BureauRecordCodec::kMaxSize;
+    for (auto id : {seq, commit, tail}) std::memset(emu.memory().data() + id + commit_off, 0, sizeof(uint64_t));
+    emu.memory()[seq + offsetof(RecordHeader, seqno)] = 5;
+    emu.memory()[tail + Bureaus::kSlotStride - 1] = 0x5A;
+
+    MramHeap heap(mram, kBase, kRegion);
+    Bureaus rs(mram, heap);
+    EXPECT_EQ(rs.reclaimed(), 1u);
+    EXPECT_EQ(rs.corrupt(), (std::vector<Bureaus::Id>{seq, tail}));
+    EXPECT_FALSE(heap.allocated(commit));
+}
+
+TEST(RecordStore, CorruptNewestSlotFallsBackToPrevious) {
+    MR25H40Emulator emu;
+    MR25H40 mram(emu);
+    MramHeap heap(mram, kBase, kRegion);
+    Bureaus rs(mram, heap);
+
+    const auto id = rs.create(make_bureau(1, 1));
+    rs.update(id, make_bureau(2, 2));
+    emu.memory()[id + Bureaus::kSlotStride + sizeof(RecordHeader)] ^= 0xFF;
+    EXPECT_EQ(rs.read(id).prog_qty, 1u);
+
+    emu.memory()[id + sizeof(RecordHeader)] ^= 0xFF;
+    EXPECT_THROW(rs.read(id), std::runtime_error);
+}
+
+TEST(RecordStore, ErrorCodesOnConcreteBackend) {
+    MR25H40Emulator emu;
+    BasicMR25H40<MR25H40Emulator> mram(emu);
+    BasicMramHeap<MR25H40Emulator> heap(mram, kBase, kRegion, std::nothrow);
+    ASSERT_TRUE(heap.try_mount());
+    BasicRecordStore<std::string, NoteCodec, MR25H40Emulator> notes(mram, heap, std::nothrow);
+    ASSERT_TRUE(notes.try_mount());
+
+    const auto id = notes.try_create("note");
+    ASSERT_TRUE(id);
+    ASSERT_TRUE(notes.try_update(*id, "note 2"));
+    EXPECT_EQ(notes.try_read(*id).value(), "note 2");
+    EXPECT_EQ(notes.try_create(std::string(201, 'z')).error(), MramErrc::Overflow);
+    EXPECT_EQ(notes.try_read(*id + 1).error(), MramErrc::BadArgument);
+    EXPECT_EQ(notes.try_update(*id + 1, "x").error(), MramErrc::BadArgument);
+
+    emu.memory()[*id + sizeof(RecordHeader)] ^= 0xFF;
+    emu.memory()[*id + decltype(notes)::kSlotStride + sizeof(RecordHeader)] ^= 0xFF;
+    EXPECT_EQ(notes.try_read(*id).error(), MramErrc::CrcMismatch);
+
+    ASSERT_TRUE(notes.try_erase(*id));
+    EXPECT_EQ(notes.try_erase(*id).error(), MramErrc::BadArgument);
+    EXPECT_FALSE(heap.allocated(*id));
+}
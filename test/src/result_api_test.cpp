@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "../../include/mram_result.h"
+#include "../../include/mram_mr25h40.h"
+#include "../../include/bureau_store.h"
+#include "../mocks/spi_mock.h"
+
+// Non-throwing API; this file is also built into the -fno-exceptions -fno-rtti profile.
+
+template <class M>
+concept HasThrowingRead = requires(M& m, std::span<uint8_t> s) { m.read(0u, s); };
+template <class S>
+concept HasThrowingStoreRead = requires(S& s) { s.read(); };
+
+static_assert(HasThrowingRead<MR25H40> == !MRAM_FREESTANDING);
+static_assert(HasThrowingStoreRead<BureauStore> == !MRAM_FREESTANDING);
+
+TEST(ResultApi, MramRoundTripAndRangeError) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+
+    std::array<uint8_t, 32> in{};
+    for (size_t i = 0; i < in.size(); ++i) in[i] = uint8_t(0xA0 + i);
+    ASSERT_TRUE(mram.try_write(0x400, in));
+
+    std::array<uint8_t, 32> out{};
+    ASSERT_TRUE(mram.try_read(0x400, out));
+    EXPECT_EQ(in, out);
+
+    auto r = mram.try_read(MR25H40::kSize - 8, out);
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error(), MramErrc::OutOfRange);
+    EXPECT_EQ(mram.try_write(MR25H40::kSize, std::span<const uint8_t>()).error(), MramErrc::OutOfRange);
+}
+
+TEST(ResultApi, ReadManyWithoutHeap) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    for (size_t i = 0; i < 0x200; ++i) spi.mem[i] = uint8_t(i);
+
+    // More requests than one sort group, in descending order: the second
+    // group lies below where the first READ stopped and takes its own
+    std::array<std::array<uint8_t, 2>, MR25H40::kReadManyGroup + 6> bufs{};
+    std::array<ReadRequest, MR25H40::kReadManyGroup + 6> reqs{};
+    for (size_t i = 0; i < reqs.size(); ++i) reqs[i] = ReadRequest{uint32_t(0x1F0 - i * 4), bufs[i]};
+
+    auto r = mram.try_read_many(reqs);
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(*r, 2u);
+    EXPECT_EQ(bufs[0][1], 0xF1);
+    EXPECT_EQ(bufs[reqs.size() - 1][0], uint8_t(0x1F0 - (reqs.size() - 1) * 4));
+
+    std::array<ReadRequest, 1> bad{ReadRequest{MR25H40::kSize, bufs[0]}};
+    EXPECT_EQ(mram.try_read_many(bad).error(), MramErrc::OutOfRange);
+}
+
+TEST(ResultApi, StoreReportsErrorCodes) {
+    SpiMock spi;
+    MR25H40 mram(spi);
+    BureauStore store(mram);
+
+    auto none = store.try_read();
+    ASSERT_FALSE(none.has_value());
+    EXPECT_EQ(none.error(), MramErrc::NoRecord);
+
+    Bureau b{.prog_qty = 77, .math_qty = 8, .head_qty = 9, .salary_sum = 10.5f};
+    ASSERT_TRUE(store.try_write(b));
+
+    auto r = store.try_read();
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->prog_qty, 77u);
+    EXPECT_EQ(r->math_qty, 8u);
+    EXPECT_EQ(r->head_qty, 9u);
+    EXPECT_FLOAT_EQ(r->salary_sum, 10.5f);
+
+    // Flip a payload byte of the only (slot A) record
+    spi.mem[sizeof(RecordHeader) + 3] ^= 0x5A;
+    auto bad = store.try_read();
+    ASSERT_FALSE(bad);
+    EXPECT_EQ(bad.error(), MramErrc::CrcMismatch);
+}
+
+TEST(ResultApi, CodecDecodes) {
+    Bureau b{.prog_qty = 1, .math_qty = 2, .head_qty = 3, .salary_sum = 4.0f};
+    std::array<uint8_t, BureauCodec::kSize> buf{};
+    BureauCodec::encode(b, buf);
+
+    auto r = BureauCodec::try_decode(buf);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->prog_qty, 1u);
+    EXPECT_FLOAT_EQ(r->salary_sum, 4.0f);
+}